@@ -0,0 +1,10 @@
+TEMPLATE = subdirs
+
+SUBDIRS = mbcore master slave mbpoll mbgate bench
+
+master.file    = master/fdc_test.pro
+master.depends = mbcore
+slave.depends  = mbcore
+mbpoll.depends = mbcore
+mbgate.depends = mbcore
+bench.depends  = mbcore
@@ -0,0 +1,134 @@
+// mbcore 코덱 마이크로벤치마크
+// 사용법 : mbbench [frames]
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QByteArray>
+#include <cstdio>
+#include <cstdlib>
+#include "mbcodec.h"
+
+static volatile float g_sink;   // 최적화로 루프가 사라지지 않도록
+
+// 응답 스트림 생성 : 03 (float 1개) 와 0x65 (5블록) 교대
+static QByteArray makeStream(int frames)
+{
+    QByteArray stream;
+    stream.reserve(frames * 49);
+    uchar buf[mb::MAX_ADU];
+    const quint16 regs[10] = {0x4366, 0x8000, 0x40A0, 0x0000, 0x4120, 0x0000, 0x447A, 0x0000, 0x41C8, 0x0000};
+    uchar desc[5 * 4];
+    const quint16 starts[5] = {11106, 11200, 11216, 11224, 11152};
+    for (int i = 0; i < 5; ++i) {
+        mb::wr16be(desc + 4 * i, starts[i]);
+        mb::wr16be(desc + 4 * i + 2, 2);
+    }
+    mb::BlockView blocks = { desc, 5 };
+    for (int i = 0; i < frames; ++i) {
+        int n;
+        if (i & 1)
+            n = mb::encodeMultiReadReply(buf, sizeof(buf), quint16(i), 1, blocks, regs, 10);
+        else
+            n = mb::encodeReadReply(buf, sizeof(buf), quint16(i), 1, regs, 2);
+        stream.append(reinterpret_cast<const char*>(buf), n);
+    }
+    return stream;
+}
+
+// 임의 위치에 쓰레기 바이트 삽입 (약 1/8 프레임)
+static QByteArray corrupt(const QByteArray& clean, unsigned seed)
+{
+    QByteArray out;
+    out.reserve(clean.size() + clean.size() / 8);
+    srand(seed);
+    for (int i = 0; i < clean.size(); ++i) {
+        if (rand() % 256 == 0) {
+            const int junk = 1 + rand() % 8;
+            for (int j = 0; j < junk; ++j)
+                out.append(char(rand() & 0xFF));
+        }
+        out.append(clean.constData() + i, 1);
+    }
+    return out;
+}
+
+static void report(const char* name, qint64 ns, quint64 items)
+{
+    const double perItem = items ? double(ns) / double(items) : 0.0;
+    const double perSec = ns ? double(items) * 1e9 / double(ns) : 0.0;
+    printf("%-28s %10.1f ns/frame %14.0f frames/s\n", name, perItem, perSec);
+}
+
+// chunk 크기로 나눠 넣으며 디코드 (chunk <= 0 이면 한 번에)
+static quint64 decodeStream(const QByteArray& stream, int chunk, quint64* resync)
+{
+    mb::FrameReader reader;
+    mb::Frame f;
+    mb::RegView regs;
+    mb::BlockView blocks;
+    quint64 frames = 0;
+    float acc = 0.0f;
+    const int step = chunk > 0 ? chunk : stream.size();
+    for (int off = 0; off < stream.size(); off += step) {
+        reader.append(stream.constData() + off, qMin(step, stream.size() - off));
+        while (reader.next(f)) {
+            if (mb::decodeReadReply(f, regs) || mb::decodeMultiReadReply(f, blocks, regs)) {
+                for (int i = 0; i < regs.floatCount(); ++i)
+                    acc += regs.floatAt(i);
+                ++frames;
+            }
+        }
+    }
+    g_sink = acc;
+    if (resync) *resync = reader.resyncBytes();
+    return frames;
+}
+
+int main(int argc, char* argv[])
+{
+    const int frames = (argc > 1) ? atoi(argv[1]) : 200000;
+    if (frames <= 0) { fprintf(stderr, "usage: %s [frames]\n", argv[0]); return 1; }
+
+    const QByteArray clean = makeStream(frames);
+    const QByteArray dirty = corrupt(clean, 1234);
+    QElapsedTimer t;
+    quint64 n, resync = 0;
+
+    t.start();
+    n = decodeStream(clean, 0, 0);
+    report("parse clean", t.nsecsElapsed(), n);
+
+    t.start();
+    n = decodeStream(clean, 1460, 0);
+    report("parse fragmented (1460B)", t.nsecsElapsed(), n);
+
+    t.start();
+    n = decodeStream(clean, 7, 0);
+    report("parse fragmented (7B)", t.nsecsElapsed(), n);
+
+    t.start();
+    n = decodeStream(dirty, 1460, &resync);
+    report("parse corrupted", t.nsecsElapsed(), n);
+    printf("%-28s %10llu bytes skipped, %llu/%d frames recovered\n", "",
+           (unsigned long long)resync, (unsigned long long)n, frames);
+
+    uchar buf[mb::MAX_ADU];
+    const quint16 starts[5] = {11106, 11200, 11216, 11224, 11152};
+    quint64 bytes = 0;
+    t.start();
+    for (int i = 0; i < frames; ++i)
+        bytes += mb::encodeReadReq(buf, sizeof(buf), quint16(i), 1, 11106, 2) + buf[1];
+    report("encode 03 request", t.nsecsElapsed(), frames);
+    t.start();
+    for (int i = 0; i < frames; ++i)
+        bytes += mb::encodeMultiReadReq(buf, sizeof(buf), quint16(i), 1, starts, 5, 2) + buf[1];
+    report("encode 0x65 request", t.nsecsElapsed(), frames);
+
+    float acc = 0.0f;
+    t.start();
+    for (int i = 0; i < frames; ++i)
+        acc += mb::pairToFloat(quint16(0x4366 + (i & 7)), quint16(i), false);
+    report("pairToFloat", t.nsecsElapsed(), frames);
+    g_sink = acc + float(bytes);
+
+    return 0;
+}
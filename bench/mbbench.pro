@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# mbcore 코덱 벤치마크 (ns/frame, frames/s)
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+QMAKE_CXXFLAGS += -std=gnu++11
+QMAKE_CXXFLAGS_RELEASE -= -O2
+QMAKE_CXXFLAGS_RELEASE += -O3
+
+include(../mbcore/mbcore.pri)
+
+TARGET = mbbench
+TEMPLATE = app
+
+
+SOURCES += mbbench.cpp
@@ -0,0 +1,114 @@
+// mbcore 프레이밍 / 디코딩 퍼저
+// libFuzzer : LLVMFuzzerTestOneInput (clang -fsanitize=fuzzer)
+// AFL       : MBFUZZ_STDIN 정의 시 stdin 입력 main()
+//
+// 입력 첫 바이트는 TCP 조각 크기, 나머지는 수신 스트림.
+// 검사 항목
+//  - 모든 view 가 프레임 안을 가리킬 것
+//  - 디코드된 응답/요청을 다시 인코딩하면 원본과 같을 것
+//  - 조각 크기와 무관하게 같은 프레임열이 나올 것
+//  - 재동기 비용이 입력 길이에 비례할 것 (바이트당 1회)
+
+#include <QtCore/QtGlobal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "mbcodec.h"
+
+#define FUZZ_CHECK(cond) do { if (!(cond)) { fprintf(stderr, "check failed: %s (%s:%d)\n", #cond, __FILE__, __LINE__); abort(); } } while (0)
+
+struct Digest
+{
+    quint64 frames;
+    quint64 frameBytes;
+    quint32 hash;
+};
+
+static void checkFrame(const mb::Frame& f)
+{
+    uchar out[mb::MAX_ADU];
+    FUZZ_CHECK(f.aduSize() == 6 + f.mb.len);
+    FUZZ_CHECK(f.aduSize() <= mb::MAX_ADU);
+    FUZZ_CHECK(f.mb.pid == 0);
+
+    mb::RegView regs;
+    mb::BlockView blocks;
+    quint16 start = 0, count = 0;
+    if (f.isException()) {
+        FUZZ_CHECK(f.pduSize == 1);
+        const int n = mb::encodeException(out, sizeof(out), f.mb.tid, f.mb.uid, f.function(), f.exceptionCode());
+        FUZZ_CHECK(n == f.aduSize() && memcmp(out, f.adu(), n) == 0);
+    }
+    if (mb::decodeReadReply(f, regs)) {
+        FUZZ_CHECK(regs.p + 2 * regs.count == f.pdu + f.pduSize);
+        std::vector<quint16> v(regs.count);
+        for (int i = 0; i < regs.count; ++i) v[i] = regs.at(i);
+        const int n = mb::encodeReadReply(out, sizeof(out), f.mb.tid, f.mb.uid, v.data(), regs.count);
+        FUZZ_CHECK(n == 0 || (n == f.aduSize() && memcmp(out, f.adu(), n) == 0));
+    }
+    if (mb::decodeMultiReadReply(f, blocks, regs)) {
+        FUZZ_CHECK(blocks.p + 4 * blocks.count == regs.p);
+        FUZZ_CHECK(regs.p + 2 * regs.count == f.pdu + f.pduSize);
+        std::vector<quint16> v(regs.count + 1);
+        for (int i = 0; i < regs.count; ++i) v[i] = regs.at(i);
+        const int n = mb::encodeMultiReadReply(out, sizeof(out), f.mb.tid, f.mb.uid, blocks, v.data(), regs.count);
+        FUZZ_CHECK(n == f.aduSize() && memcmp(out, f.adu(), n) == 0);
+        float acc = 0.0f;
+        for (int i = 0; i < regs.floatCount(); ++i) acc += regs.floatAt(i);
+        (void)acc;
+    }
+    if (mb::decodeReadRequest(f, start, count)) {
+        const int n = mb::encodeReadReq(out, sizeof(out), f.mb.tid, f.mb.uid, start, count);
+        FUZZ_CHECK(n == f.aduSize() && memcmp(out, f.adu(), n) == 0);
+    }
+    if (mb::decodeMultiReadRequest(f, blocks)) {
+        FUZZ_CHECK(blocks.p + 4 * blocks.count == f.pdu + f.pduSize);
+    }
+}
+
+static Digest run(const uchar* data, int size, int chunk)
+{
+    Digest d = { 0, 0, 2166136261u };
+    mb::FrameReader reader;
+    mb::Frame f;
+    for (int off = 0; off < size; off += chunk) {
+        reader.append(reinterpret_cast<const char*>(data) + off, qMin(chunk, size - off));
+        while (reader.next(f)) {
+            checkFrame(f);
+            ++d.frames;
+            d.frameBytes += f.aduSize();
+            for (int i = 0; i < f.aduSize(); ++i)
+                d.hash = (d.hash ^ f.adu()[i]) * 16777619u;
+        }
+    }
+    // 각 입력 바이트는 프레임에 속하거나, 1회 건너뛰거나 (버린 프레임 포함), 아직 대기 중이다
+    FUZZ_CHECK(d.frameBytes + reader.resyncBytes() + quint64(reader.pending()) == quint64(size));
+    return d;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if (size < 1 || size > (1 << 20)) return 0;
+    const int chunk = 1 + data[0];
+    const uchar* stream = data + 1;
+    const int n = int(size - 1);
+
+    const Digest whole = run(stream, n, qMax(n, 1));
+    const Digest split = run(stream, n, chunk);
+    FUZZ_CHECK(whole.frames == split.frames);
+    FUZZ_CHECK(whole.hash == split.hash);
+    return 0;
+}
+
+#ifdef MBFUZZ_STDIN
+int main()
+{
+    std::vector<uint8_t> in;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), stdin)) > 0)
+        in.insert(in.end(), buf, buf + n);
+    return LLVMFuzzerTestOneInput(in.data(), in.size());
+}
+#endif
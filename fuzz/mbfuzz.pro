@@ -0,0 +1,40 @@
+#-------------------------------------------------
+#
+# mbcore 프레이밍 / 디코딩 퍼저
+#   libFuzzer : qmake && make            (clang 필요)
+#   AFL       : qmake CONFIG+=afl && make (afl-clang++ 필요)
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG += c++11 console debug
+CONFIG -= app_bundle
+
+QMAKE_CXXFLAGS += -std=gnu++11 -O1 -g
+
+afl {
+    QMAKE_CXX  = afl-clang++
+    QMAKE_LINK = afl-clang++
+    DEFINES   += MBFUZZ_STDIN
+    QMAKE_CXXFLAGS += -fsanitize=address,undefined
+    QMAKE_LFLAGS   += -fsanitize=address,undefined
+}
+else {
+    QMAKE_CXX  = clang++
+    QMAKE_LINK = clang++
+    QMAKE_CXXFLAGS += -fsanitize=fuzzer-no-link,address,undefined
+    QMAKE_LFLAGS   += -fsanitize=fuzzer,address,undefined
+}
+
+# 코덱은 퍼저와 같은 계측으로 직접 빌드한다
+INCLUDEPATH += ../mbcore
+DEPENDPATH  += ../mbcore
+
+TARGET = mbfuzz
+TEMPLATE = app
+
+
+SOURCES += mbfuzz.cpp\
+        ../mbcore/mbcodec.cpp
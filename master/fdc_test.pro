@@ -32,13 +32,17 @@ QMAKE_CXXFLAGS += -std=gnu++11
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+include(../mbcore/mbcore.pri)
+
 TARGET = fdc_test
 TEMPLATE = app
 
 
 SOURCES += main.cpp\
-        mainwindow.cpp
+        mainwindow.cpp\
+        presenter.cpp
 
-HEADERS  += mainwindow.h
+HEADERS  += mainwindow.h\
+        presenter.h
 
 FORMS    += mainwindow.ui
@@ -1,10 +1,30 @@
 #include "mainwindow.h"
 #include <QApplication>
+#include <QStringList>
+#include <QtDebug>
+#include "metricsserver.h"
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    // fdc_test -m port : metrics endpoint (127.0.0.1, 0 = 끔)
+    quint16 metricsPort = 9102;
+    const QStringList args = a.arguments();
+    const int mi = args.indexOf("-m");
+    if (mi > 0 && mi + 1 < args.size()) metricsPort = args[mi + 1].toUShort();
+    MetricsServer metricsServer;
+    QString err;
+    if (metricsPort && !metricsServer.listen(metricsPort, &err))
+        qWarning("%s", qPrintable(err));
+
     MainWindow w;
+    // fdc_test -u [retries] : Modbus/UDP (timeout 된 요청을 retries 번 다시 보냄, 기본 2)
+    const int ui = args.indexOf("-u");
+    if (ui > 0) {
+        bool ok = false;
+        const int retries = (ui + 1 < args.size()) ? args[ui + 1].toInt(&ok) : 0;
+        w.useUdp(ok ? retries : 2);
+    }
     w.show();
 
     return a.exec();
@@ -5,26 +5,41 @@
 #include <QAbstractTableModel>
 #include <QHostAddress>
 #include <QtEndian>
-#include <QDataStream>
 #include <cstring>
 #include <QFile>
 #include <QTimer>
-#include <QDebug>
 #include <qwt_legend.h>
 #include <qwt_plot_grid.h>
 
-static inline quint16 rd16be(const uchar* p){ return quint16((p[0] << 8) | p[1]); }
-
-int applyCnt = 0;
-
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
      ui(new Ui::MainWindow),
      plot(nullptr),
      panner(nullptr),
-    m_sock(new QTcpSocket(this))
+    m_poller(new MbPoller(this)),
+    m_histDirty(0),
+    m_view(new Presenter(this)),
+    m_t0Ns(0)
 {
     ui->setupUi(this);
+    for (int i = 0; i < CURVES; ++i)
+        m_hist[i] = new History(HISTORY_BLOCKS);
+    m_viewId[VIEW_STATUS] = m_view->addTarget(ui->apply_test);
+    m_viewId[VIEW_V] = m_view->addTarget(ui->label_v);
+    m_viewId[VIEW_A] = m_view->addTarget(ui->label_a);
+    m_viewId[VIEW_KW] = m_view->addTarget(ui->label_kw);
+    m_viewId[VIEW_KWH] = m_view->addTarget(ui->label_kwh);
+    m_viewId[VIEW_TEMP] = m_view->addTarget(ui->label_temp);
+    m_view->setLog(ui->signLog);
+    m_view->setTable(ui->parsetest_tableWidget);
+    m_poller->attachMetrics("role=\"master\"");
+    connect(m_poller, SIGNAL(replyReady(MbReply)), this, SLOT(onReply(MbReply)));
+    connect(m_poller, SIGNAL(requestTimedOut(int,quint16)), this, SLOT(onRequestTimedOut(int,quint16)));
+    m_aggCh[0] = m_agg.addChannel(Aggregator::Instant);
+    m_aggCh[1] = m_agg.addChannel(Aggregator::Instant);
+    m_aggCh[2] = m_agg.addChannel(Aggregator::Power);
+    m_aggCh[3] = m_agg.addChannel(Aggregator::Energy);
+    m_aggCh[4] = m_agg.addChannel(Aggregator::Instant);
 
     setWindowTitle(tr("fdc_test"));
     m_autoTimer = new QTimer(this);
@@ -34,7 +49,7 @@ MainWindow::MainWindow(QWidget *parent) :
     plot = new QwtPlot(ui->widget);
     plot->setTitle("RESPONE");
     plot->setCanvasBackground(Qt::white);
-    plot->setAxisTitle(QwtPlot::xBottom, "TIME");
+    plot->setAxisTitle(QwtPlot::xBottom, "TIME [s]");
     plot->setAxisTitle(QwtPlot::yLeft, "VAL");
 
     plot->setGeometry(ui->widget->rect());
@@ -45,7 +60,7 @@ MainWindow::MainWindow(QWidget *parent) :
     QwtPlotGrid *grid = new QwtPlotGrid();
     grid->attach(plot);
 
-    for (int i = 0; i < 5; ++i) {
+    for (int i = 0; i < CURVES; ++i) {
         curve[i] = new QwtPlotCurve(QString("Reg %1").arg(i));
         curve[i]->setRenderHint(QwtPlotItem::RenderAntialiased);
         curve[i]->setStyle(QwtPlotCurve::Lines);
@@ -64,13 +79,24 @@ MainWindow::MainWindow(QWidget *parent) :
 
     plot->setAxisScale(QwtPlot::xBottom, 0.0, 10.0);
     plot->setAxisScale(QwtPlot::yLeft, 0.0, 240.0);
+    m_view->setPlot(plot);
+    connect(m_view, SIGNAL(aboutToReplot()), this, SLOT(refreshCurves()));
 }
 
 MainWindow::~MainWindow()
 {
+    for (int i = 0; i < CURVES; ++i)
+        delete m_hist[i];
     delete ui;
 }
 
+void MainWindow::useUdp(int retries)
+{
+    m_poller->setTransport(MbPoller::UDP);
+    m_poller->setRetries(retries);
+    setWindowTitle(windowTitle() + " [UDP]");
+}
+
 void MainWindow::on_addr_toggled(bool checked)
 {
     ui->ip->setReadOnly(checked);
@@ -108,144 +134,16 @@ void MainWindow::on_connect_clicked()
         ui->label->setText("no connection");
         return;
     }
-    if (m_sock->state() != QAbstractSocket::UnconnectedState)
-        m_sock->abort();
-    m_sock->connectToHost(ip, port);
-    if (!m_sock->waitForConnected(timeoutMs))
+    m_poller->setTimeout(timeoutMs);
+    QString em;
+    if (!m_poller->connectBlocking(ip, port, timeoutMs, &em))
     {
-        const QString em = m_sock->errorString();
         QMessageBox::critical(this, "Connect Fail", QString("server(%1:%2) connect fail : %3").arg(ip).arg(port).arg(em));
         ui->label->setText("no connection");
         return;
     }
     QMessageBox::information(this, "Connected", QString("server(%1:%2) connected").arg(ip).arg(port));
     ui->label->setText("connected");
-    connect(m_sock, SIGNAL(readyRead()), this, SLOT(onSockReadyRead()));
-}
-
-bool MainWindow::takeOneModbusTcpFrame(QByteArray &buf, QByteArray &outFrame)
-{
-    if (buf.size() < 7) return false;
-    const uchar* p = reinterpret_cast<const uchar*>(buf.constData());
-    const quint16 pid = qFromBigEndian<quint16>(p + 2);
-    const quint16 len = qFromBigEndian<quint16>(p + 4);
-
-    if (pid != 0x0000)
-    {
-        buf.remove(0, 1);
-        return false;
-    }
-    if (len < 2)
-    {
-        buf.remove(0, 1);
-        return false;
-    }
-
-    const int total = 6 + (int)len;
-    const int MAX_FRAME = 4096;
-    if (total > MAX_FRAME)
-    {
-        buf.remove(0, 1);
-        return false;
-    }
-    if (buf.size() < total)
-        return false;
-
-    outFrame = buf.left(total);
-    buf.remove(0, total);
-    return true;
-}
-
-bool MainWindow::parseModbusTcpFrame(const QByteArray& frame, Mbap& mb, quint8& fc, QByteArray& pdu)
-{
-    if (frame.size() < 8) return false;
-    const uchar* p = reinterpret_cast<const uchar*>(frame.constData());
-    mb.tid = qFromBigEndian<quint16>(p + 0);
-    mb.pid = qFromBigEndian<quint16>(p + 2);
-    mb.len = qFromBigEndian<quint16>(p + 4);
-    mb.uid = *(p + 6);
-
-    if (mb.pid != 0x0000) return false;
-    if (mb.len < 2) return false;
-
-    fc  = *(p + 7); // funccode
-    if(fc == 0x03) // 03
-        pdu = frame.mid(8);
-    else if(fc == 0x65) // 101
-    {
-        pdu = frame.mid(8, 1);
-        switch(frame.size())
-        {
-        case 25:
-            pdu.append(frame.mid(17));
-            break;
-        case 33:
-            pdu.append(frame.mid(21));
-            break;
-        case 41:
-            pdu.append(frame.mid(25));
-            break;
-        case 49:
-            pdu.append(frame.mid(29));
-            break;
-        }
-    }
-    applyCnt++;
-    return true;
-}
-
-QByteArray MainWindow::buildModbusReadReq(quint16 transId, quint8 unitId, quint16 startAddr, quint16 regCount)
-{
-    QByteArray frame;
-    QDataStream out(&frame, QIODevice::WriteOnly);
-    out.setByteOrder(QDataStream::BigEndian);
-    out << transId;
-    out << quint16(0x0000);
-    out << quint16(6);
-    out << unitId;
-    out << quint8(0x03); //funcCode
-    out << startAddr;
-    out << regCount;
-    return frame;
-}
-
-QByteArray MainWindow::buildModbusMultiReadReq(quint16 transId, quint8 unitId, QStringList Addrs, quint16 regCount)
-{
-    QByteArray frame;
-    QDataStream out(&frame, QIODevice::WriteOnly);
-    out.setByteOrder(QDataStream::BigEndian);
-    quint8 functionCode = 0x65;
-    quint8 numBlocks    = Addrs.size();
-    out << transId;
-    out << quint16(0x0000);
-    quint16 pduLength = 1 + 1 + 1 + (numBlocks * 4);
-    out << quint16(pduLength);
-    out << unitId;
-    out << functionCode;
-    out << numBlocks;
-
-    for (int i = 0; i < Addrs.size(); i++)
-    {
-        bool ok = false;
-        quint16 mapAddr = Addrs[i].toUShort(&ok, 10);
-        if (!ok) continue;
-
-        quint16 startAddr = (mapAddr > 0) ? (mapAddr - 1) : 0;
-        out << startAddr;
-        out << regCount;
-    }
-
-
-
-    return frame;
-}
-
-static inline float pairToFloat(quint16 hi, quint16 lo, bool swap)
-{
-    quint32 u = swap ? ((quint32(lo) << 16) | hi) : ((quint32(hi) << 16) | lo);
-    float f;
-    memcpy(&f, &u, sizeof(float));
-    return f;
 }
 
 void MainWindow::sendModbusReq()
@@ -253,58 +151,35 @@ void MainWindow::sendModbusReq()
     bool ok = false;
     QString strAddrs= ui->start_addr->text().trimmed();
     QStringList Addrs = strAddrs.split(",");
-    if(Addrs.size() <= 1)
+    quint8  unitId   = 1;
+    quint16 regCount = 2;
+    quint16 starts[255];
+    int nBlocks = 0;
+    for (int i = 0; i < Addrs.size() && nBlocks < 255; i++)
     {
-        quint16 mapAddr = ui->start_addr->text().toUShort(&ok, 10);
-        if (!ok)
-        {
-            QMessageBox::warning(this, "entering", "address");
-            return;
-        }
-        quint16 startAddr = (mapAddr > 0) ? (mapAddr - 1) : 0;
-        quint16 transactionId = 0x0013;
-        quint8  unitId        = 1;
-        quint16 regCount      = 2;
-        QByteArray baseline = buildModbusReadReq(transactionId, unitId, startAddr, regCount);
-        //log
-        QByteArray hex = baseline.toHex().toUpper();
-        QString spacedHex;
-        for (int i = 0; i < hex.size(); i += 2) {
-            if (i > 0) spacedHex += " ";
-            spacedHex += hex.mid(i, 2);
-        }
-        ui->signLog->append(QString("Modbus Req : %1\n").arg(spacedHex));
-
-        QByteArray req = baseline;
-        if (!m_sock || m_sock->state() != QAbstractSocket::ConnectedState) { QMessageBox::warning(this, "network", "not connected"); return; }
-        m_sock->write(req);
-        m_sock->flush();
+        quint16 mapAddr = Addrs[i].trimmed().toUShort(&ok, 10);
+        if (!ok) continue;
+        starts[nBlocks++] = (mapAddr > 0) ? (mapAddr - 1) : 0;
     }
-    else
+    if (nBlocks == 0)
     {
-        quint16 transactionId = 0x0013;
-        quint8  unitId = 1;
-        quint16 regCount = 2;
-        QByteArray baseline = buildModbusMultiReadReq(transactionId, unitId, Addrs, regCount);
-        //log
-        QByteArray hex = baseline.toHex().toUpper();
-        QString spacedHex;
-        for (int i = 0; i < hex.size(); i += 2)
-        {
-            if (i > 0) spacedHex += " ";
-            spacedHex += hex.mid(i, 2);
-        }
-        ui->signLog->append(QString("Modbus Req : %1\n").arg(spacedHex));
-
-        QByteArray req = baseline;
-        if (!m_sock || m_sock->state() != QAbstractSocket::ConnectedState)
-        {
-            QMessageBox::warning(this, "network", "not connected");
-            return;
-        }
-        m_sock->write(req);
-        m_sock->flush();
+        QMessageBox::warning(this, "entering", "address");
+        return;
+    }
+    if (!m_poller->isConnected())
+    {
+        QMessageBox::warning(this, "network", "not connected");
+        return;
     }
+    uchar req[mb::MAX_ADU];
+    int reqLen = 0;
+    if (Addrs.size() <= 1)
+        reqLen = m_poller->sendRead(unitId, starts[0], regCount, req);
+    else
+        reqLen = m_poller->sendMultiRead(unitId, starts, nBlocks, regCount, req);
+    //log
+    if (reqLen > 0)
+        m_view->appendLog("Modbus Req : ", req, reqLen);
 }
 
 void MainWindow::on_apply_clicked()
@@ -321,163 +196,132 @@ void MainWindow::on_apply_clicked()
     sendModbusReq();
 }
 
-void MainWindow::onSockReadyRead()
+void MainWindow::onReply(const MbReply& r)
 {
-    m_cliBuf.append(m_sock->readAll());
-    QByteArray frame;
-    float avgV;
-    quint16 fir;
-    quint16 sec;
-    while (takeOneModbusTcpFrame(m_cliBuf, frame))
+    const mb::Frame& f = r.frame;
+    // 수신 시각 : 집계는 epoch ms, plot x 는 첫 응답 이후 초
+    const qint64 nowMs = mb::monoToEpochMs(r.rxNs);
+    if (m_t0Ns == 0) m_t0Ns = r.rxNs;
+    const double t = double(r.rxNs - m_t0Ns) / 1e9;
+    //log
+    m_view->appendLog(QString("Modbus Res (%1 ms) : ").arg(r.rttUs / 1000.0, 0, 'f', 1), f.adu(), f.aduSize());
+    const mb::RegView& regs = r.regs;
+    if (f.isException())
     {
-        Mbap mb;
-        quint8 fc = 0;
-        QByteArray pdu;
-        //log
-        QByteArray hex = frame.toHex().toUpper();
-        QString spacedHex;
-        for (int i = 0; i < hex.size(); i += 2)
-        {
-            if (i > 0) spacedHex += " ";
-            spacedHex += hex.mid(i, 2);
-        }
-        ui->signLog->append(QString("Modbus Res : %1\n").arg(spacedHex));
-        if (!parseModbusTcpFrame(frame, mb, fc, pdu)) continue;
-        if (fc == 0x03)
+        m_view->setText(m_viewId[VIEW_STATUS], QString("TID=%1 UID=%2 FC=0x%3 | EXCEPTION=%4").arg(f.mb.tid).arg(f.mb.uid).arg(f.function(), 2, 16, QLatin1Char('0')).arg(f.exceptionCode()));
+    }
+    else if (f.fc == mb::FC_READ_HOLDING)
+    {
+        if (regs.count == 0) return;
+        const int nRegs = regs.count;
+        const bool swapWords = false;
+        if (regs.floatCount() > 0) // 11107
         {
-            if (pdu.size() < 1) continue;
-            const quint8 byteCount = (quint8)pdu[0];
-            if (pdu.size() != 1 + byteCount) continue;
-            if (byteCount % 2 != 0) continue;
-            const int nRegs = byteCount / 2;
-            QVector<quint16> regs;
-            regs.reserve(nRegs);
-            const uchar* ptr = (const uchar*)pdu.constData() + 1;
-            for (int i = 0; i < nRegs; ++i)
-                regs.push_back(qFromBigEndian<quint16>(ptr + 2*i));
-            const bool swapWords = false;
-            QVector<float> floats;
-            for (int i = 0; i + 1 < regs.size(); i += 2)
-                floats.push_back(pairToFloat(regs[i], regs[i+1], swapWords));
-            if (!floats.isEmpty()) // 11107
+            const float v = regs.floatAt(0, swapWords);
+            aggregate(nowMs, &v, 1);
+            const double st[4] = { double(f.mb.tid), double(f.mb.uid), double(nRegs), v };
+            if (ui->start_addr->text().trimmed() == "11107")
             {
-                if (ui->start_addr->text().trimmed() == "11107")
-                {
-
-                    if (ui->apply_test)
-                        ui->apply_test->setText(QString("TID=%1 UID=%2 FC=03 | REGS=%3 | Vavg_ln=%4 V").arg(mb.tid).arg(mb.uid).arg(nRegs).arg(floats[0], 0, 'f', 3));
-                    ui->label_v->setText(QString("Vavg_ln = %1 V").arg((floats[0]/applyCnt), 0, 'f', 3));
-                    onAddValue((double)applyCnt, (double)floats[0], 0);
-                }
-                else
-                {
-                    if (ui->apply_test)
-                        ui->apply_test->setText(QString("TID=%1 UID=%2 FC=03 | REGS=%3 | Reg = %4 ").arg(mb.tid).arg(mb.uid).arg(nRegs).arg(floats[0], 0, 'f', 3));
-                    ui->label_v->setText(QString("Reg = %1 ").arg((floats[0]/applyCnt), 0, 'f', 3));
-                }
+                m_view->setValues(m_viewId[VIEW_STATUS], "TID=%.0f UID=%.0f FC=03 | REGS=%.0f | Vavg_ln=%.3f V", st, 4);
+                m_view->setValue(m_viewId[VIEW_V], "Vavg_ln = %.3f V", m_aggStats[0].min1.avg);
+                onAddValue(t, (double)v, 0);
             }
             else
             {
-                if (ui->apply_test) ui->apply_test->setText(QString("TID=%1 UID=%2 FC=03 | REGS=%3").arg(mb.tid).arg(mb.uid).arg(nRegs));
+                m_view->setValues(m_viewId[VIEW_STATUS], "TID=%.0f UID=%.0f FC=03 | REGS=%.0f | Reg = %.3f ", st, 4);
+                m_view->setValue(m_viewId[VIEW_V], "Reg = %.3f ", m_aggStats[0].min1.avg);
             }
-            auto setRegsToTable = [&](const QVector<quint16>& regsRef)
-            {
-                for (int r=0; r<(regsRef.size()); ++r)
-                {
-                    if (!ui->parsetest_tableWidget->item(r,0))
-                        ui->parsetest_tableWidget->setItem(r,0,new QTableWidgetItem);
-                    ui->parsetest_tableWidget->item(r,0)->setText(QString::number(regsRef[r]));
-                }
-            };
-            setRegsToTable(regs);
         }
-        else if (fc == 0x65)
+        else
+        {
+            const double st[3] = { double(f.mb.tid), double(f.mb.uid), double(nRegs) };
+            m_view->setValues(m_viewId[VIEW_STATUS], "TID=%.0f UID=%.0f FC=03 | REGS=%.0f", st, 3);
+        }
+        quint16 cells[mb::MAX_ADU / 2];      // 응답 PDU 가 담을 수 있는 레지스터 수 이상
+        for (int row = 0; row < regs.count; ++row)
+            cells[row] = regs.at(row);
+        m_view->setCells(0, cells, regs.count);
+    }
+    else if (f.fc == mb::FC_MULTI_READ)
+    {
+        if (regs.count == 0) return;
+        const bool swapWords = false;
+        for (int i = 0; i < regs.floatCount(); ++i)
+            floats.push_back(regs.floatAt(i, swapWords));
+        aggregate(nowMs, floats.constData(), floats.size());
+
+        // 상태줄 값 : TID, UID, 개수, Reg1 ..
+        double st[Presenter::MAX_VALUES] = { double(f.mb.tid), double(f.mb.uid), double(floats.size()) };
+        for (int i = 0; i < floats.size() && 3 + i < Presenter::MAX_VALUES; ++i)
+            st[3 + i] = floats[i];
+        switch(floats.size())
+        {
+        case 0:
+            m_view->setValues(m_viewId[VIEW_STATUS], "TID=%.0f UID=%.0f FC=03 | REGS=%.0f", st, 3);
+            break;
+        case 2:
+            m_view->setValues(m_viewId[VIEW_STATUS], "TID=%.0f UID=%.0f FC=03 | REGS=%.0f | Reg1=%.3f | Reg2 = %.3f", st, 5);
+            m_view->setValue(m_viewId[VIEW_V], "Reg1 = %.3f ", m_aggStats[0].min1.avg);
+            m_view->setValue(m_viewId[VIEW_A], "Reg2 = %.3f ", m_aggStats[1].min1.avg);
+//            for(int plots = 0; plots < floats.size(); plots++) { onAddValue(t, floats[plots], plots); }
+            break;
+        case 3:
+            m_view->setValues(m_viewId[VIEW_STATUS], "TID=%.0f UID=%.0f FC=03 | REGS=%.0f | Reg1=%.3f | Reg2 = %.3f | Reg3 = %.3f", st, 6);
+            m_view->setValue(m_viewId[VIEW_V], "Reg1 = %.3f ", m_aggStats[0].min1.avg);
+            m_view->setValue(m_viewId[VIEW_A], "Reg2 = %.3f ", m_aggStats[1].min1.avg);
+            m_view->setValue(m_viewId[VIEW_KW], "Reg3 = %.3f ", m_aggStats[2].min1.avg);
+//            for(int plots = 0; plots < floats.size(); plots++) { onAddValue(t, floats[plots], plots); }
+            break;
+        case 4: // reg 11107,11201,11217,11225
+        case 5: // reg 11107,11201,11217,11225,11153
         {
-            if (pdu.size() < 1) continue;
-            const quint8 byteCount = 4;
-            if (byteCount % 2 != 0) continue;
-            for(int nAddr = 0; nAddr < pdu.size(); nAddr+=4)
+            if (floats.size() == 4)
+                m_view->setValues(m_viewId[VIEW_STATUS], "TID=%.0f UID=%.0f FC=03 | REGS=%.0f | Vavg_ln=%.3f V | Iavg = %.3f A | kWtotal = %.3f kW | kWh = %.3f", st, 7);
+            else
+                m_view->setValues(m_viewId[VIEW_STATUS], "TID=%.0f UID=%.0f FC=03 | REGS=%.0f | Vavg_ln=%.3f V | Iavg = %.3f A | kWtotal = %.3f kW | kWh = %.3f | Temp = %.3f", st, 8);
+            m_view->setValue(m_viewId[VIEW_V], "Vavg_ln = %.3f V", m_aggStats[0].min1.avg);
+            m_view->setValue(m_viewId[VIEW_A], "Iavg = %.3f A", m_aggStats[1].min1.avg);
+            const double kw[2] = { floats[2], m_aggStats[2].slidingDemand };
+            m_view->setValues(m_viewId[VIEW_KW], "kW = %.3f kW | demand = %.3f kW", kw, 2);
+            const double kwh[2] = { floats[3], m_aggStats[3].energyBlock };
+            m_view->setValues(m_viewId[VIEW_KWH], "kWh = %.3f kWh | 15m = %.3f kWh", kwh, 2);
+            if (floats.size() == 5)
             {
-                const int nRegs = byteCount / 2;
-                QVector<quint16> regs;
-                regs.reserve(nRegs);
-                const uchar* ptr = (const uchar*)pdu.constData() + 1;
-                for (int i = 0; i < nRegs; ++i)
-                    regs.push_back(qFromBigEndian<quint16>(ptr + nAddr + 2*i));
-                const bool swapWords = false;
-                for (int i = 0; i + 1 < regs.size(); i += 2)
-                    floats.push_back(pairToFloat(regs[i], regs[i+1], swapWords));
-
-                if (!floats.isEmpty())
-                {
-                    qDebug() << "floats size : " << floats.size();
-                    switch(floats.size())
-                    {
-                    case 2:
-                        if (ui->apply_test)
-                            ui->apply_test->setText(QString("TID=%1 UID=%2 FC=03 | REGS=%3 | Reg1=%4 | Reg2 = %5")
-                                                    .arg(mb.tid).arg(mb.uid).arg(floats.size()).arg(floats[0], 0, 'f', 3).arg(floats[1], 0, 'f', 3));
-                        ui->label_v->setText(QString("Reg1 = %1 ").arg((floats[0]/applyCnt), 0, 'f', 3));
-                        ui->label_a->setText(QString("Reg2 = %1 ").arg((floats[1]/applyCnt), 0, 'f', 3));
-//                        for(int plots = 0; plots < floats.size(); plots++) { onAddValue((double)applyCnt, floats[plots], plots); }
-                        break;
-                    case 3:
-                        if (ui->apply_test)
-                            ui->apply_test->setText(QString("TID=%1 UID=%2 FC=03 | REGS=%3 | Reg1=%4 | Reg2 = %5 | Reg3 = %6")
-                                                    .arg(mb.tid).arg(mb.uid).arg(floats.size()).arg(floats[0], 0, 'f', 3).arg(floats[1], 0, 'f', 3).arg(floats[2], 0, 'f', 3));
-                        ui->label_v->setText(QString("Reg1 = %1 ").arg((floats[0]/applyCnt), 0, 'f', 3));
-                        ui->label_a->setText(QString("Reg2 = %1 ").arg((floats[1]/applyCnt), 0, 'f', 3));
-                        ui->label_kw->setText(QString("Reg3 = %1 ").arg((floats[2]/applyCnt), 0, 'f', 3));
-//                        for(int plots = 0; plots < floats.size(); plots++) { onAddValue((double)applyCnt, floats[plots], plots); }
-                        break;
-                    case 4:
-                        if (ui->apply_test) // reg 11107,11201,11217,11225
-                            ui->apply_test->setText(QString("TID=%1 UID=%2 FC=03 | REGS=%3 | Vavg_ln=%4 V | Iavg = %5 A | kWtotal = %6 kW | kWh = %7")
-                                                    .arg(mb.tid).arg(mb.uid).arg(floats.size()).arg(floats[0], 0, 'f', 3).arg(floats[1], 0, 'f', 3).arg(floats[2], 0, 'f', 3).arg(floats[3], 0, 'f', 3));
-                        ui->label_v->setText(QString("Vavg_ln = %1 V").arg((floats[0]/applyCnt), 0, 'f', 3));
-                        ui->label_a->setText(QString("Iavg = %1 A").arg((floats[1]/applyCnt), 0, 'f', 3));
-                        ui->label_kw->setText(QString("kW = %1 kW").arg((floats[2]/applyCnt), 0, 'f', 3));
-                        ui->label_kwh->setText(QString("kWh = %1 kWh").arg((floats[3]/applyCnt), 0, 'f', 3));
-//                        for(int plots = 0; plots < floats.size(); plots++) { onAddValue((double)applyCnt, floats[plots], plots); }
-                        break;
-                    case 5:
-                        if (ui->apply_test) // reg 11107,11201,11217,11225,11153
-                            ui->apply_test->setText(QString("TID=%1 UID=%2 FC=03 | REGS=%3 | Vavg_ln=%4 V | Iavg = %5 A | kWtotal = %6 kW | kWh = %7 | Temp = %8")
-                                                    .arg(mb.tid).arg(mb.uid).arg(floats.size()).arg(floats[0], 0, 'f', 3).arg(floats[1], 0, 'f', 3).arg(floats[2], 0, 'f', 3).arg(floats[3], 0, 'f', 3).arg(floats[4], 0, 'f', 3));
-                        ui->label_v->setText(QString("Vavg_ln = %1 V").arg((floats[0]), 0, 'f', 3));
-                        ui->label_a->setText(QString("Iavg = %1 A").arg((floats[1]), 0, 'f', 3));
-                        ui->label_kw->setText(QString("kW = %1 kW").arg((floats[2]), 0, 'f', 3));
-                        ui->label_kwh->setText(QString("kWh = %1 kWh").arg((floats[3]), 0, 'f', 3));
-                        ui->label_temp->setText(QString("temp = %1 `C").arg((floats[4]), 0, 'f', 3));
-                        for(int plots = 0; plots < floats.size(); plots++) { onAddValue((double)applyCnt, floats[plots], plots); }
-                        break;
-                    }
-                }
-                else
-                {
-                    if (ui->apply_test) ui->apply_test->setText(QString("TID=%1 UID=%2 FC=03 | REGS=%3").arg(mb.tid).arg(mb.uid).arg(floats.size()));
-                }
-
-                auto setRegsToTable = [&](const QVector<quint16>& regsRef)
-                {
-                    for (int r= 0; r<(regsRef.size()); ++r)
-                    {
-                        if (!ui->parsetest_tableWidget->item(nApply,0))
-                            ui->parsetest_tableWidget->setItem(nApply,0,new QTableWidgetItem);
-                        ui->parsetest_tableWidget->item(nApply,0)->setText(QString::number(regsRef[r]));
-                        nApply += 1;
-                    }
-                };
-                setRegsToTable(regs);
+                m_view->setValue(m_viewId[VIEW_TEMP], "temp = %.3f `C", floats[4]);
+                for(int plots = 0; plots < floats.size(); plots++) { onAddValue(t, floats[plots], plots); }
             }
+            break;
         }
-        else
-        {
-            if (ui->apply_test) ui->apply_test->setText(QString("TID=%1 UID=%2 FC=0x%3 LEN=%4").arg(mb.tid).arg(mb.uid).arg(fc, 2, 10, QLatin1Char('0')).arg(pdu.size()));
         }
+
+        quint16 cells[mb::MAX_ADU / 2];      // 응답 PDU 가 담을 수 있는 레지스터 수 이상
+        for (int row = 0; row < regs.count; ++row)
+            cells[row] = regs.at(row);
+        m_view->setCells(nApply, cells, regs.count);
+        nApply += regs.count;
+    }
+    else
+    {
+        m_view->setText(m_viewId[VIEW_STATUS], QString("TID=%1 UID=%2 FC=0x%3 LEN=%4").arg(f.mb.tid).arg(f.mb.uid).arg(f.fc, 2, 10, QLatin1Char('0')).arg(f.pduSize));
     }
 }
 
+// 표시 순서 (V, I, kW, kWh, temp) 대로 집계기에 넣고 통계를 갱신
+void MainWindow::aggregate(qint64 tMs, const float* v, int n)
+{
+    for (int i = 0; i < n && i < 5; ++i)
+    {
+        m_agg.add(m_aggCh[i], tMs, v[i]);
+        m_agg.stats(m_aggCh[i], tMs, m_aggStats[i]);
+    }
+}
+
+void MainWindow::onRequestTimedOut(int item, quint16 tid)
+{
+    Q_UNUSED(item);
+    m_view->appendLog(QString("Modbus Timeout : TID=%1").arg(tid));
+}
+
 void MainWindow::onAutoApplyTimeout()
 {
     on_apply_clicked();
@@ -490,27 +334,29 @@ void MainWindow::on_stop_clicked()
 
 void MainWindow::addPoint(double x, double y, int nReg)
 {
-    if (nReg < 0 || nReg >= 4) return;
+    if (nReg < 0 || nReg >= CURVES) return;
     if (!curve[nReg]) return;
 
-    xData[nReg].append(x);
-    yData[nReg].append(y);
-
-    const int maxPoints = 100000;
-    if (xData[nReg].size() > maxPoints) {
-        int removeCnt = xData[nReg].size() - maxPoints;
-        xData[nReg].remove(0, removeCnt);
-        yData[nReg].remove(0, removeCnt);
-    }
+    // 오래된 점은 block 단위로 버려진다
+    if (!m_hist[nReg]->append(qRound64(x * 1000.0), y)) return;
+    m_histDirty |= 1u << nReg;
+    m_view->replotLater();
+}
 
-    int sz = xData[nReg].size();
-    if (sz > 0) {
-        curve[nReg]->setData(xData[nReg].constData(), yData[nReg].constData(), sz);
-    } else {
-        curve[nReg]->setData(nullptr, nullptr, 0);
+// 바뀐 곡선만 frame 당 한 번 decode 해서 넘긴다 (setData 는 복사)
+void MainWindow::refreshCurves()
+{
+    for (int i = 0; i < CURVES; ++i) {
+        if (!(m_histDirty & (1u << i))) continue;
+        const History& h = *m_hist[i];
+        const int sz = h.scan(h.firstTime(), h.lastTime(), m_plotX, m_plotY, 0);
+        if (sz > 0) {
+            curve[i]->setData(m_plotX.constData(), m_plotY.constData(), sz);
+        } else {
+            curve[i]->setData(nullptr, nullptr, 0);
+        }
     }
-
-    plot->replot();
+    m_histDirty = 0;
 }
 
 
@@ -518,8 +364,8 @@ void MainWindow::onAddValue(double x, double y, int nReg)
 {
     addPoint(x, y, nReg);
 
-//    if (!xData[nReg].isEmpty()) {
-//        double xmax = xData[nReg].last();
+//    if (!m_hist[nReg]->isEmpty()) {
+//        double xmax = m_hist[nReg]->lastTime() / 1000.0;
 //        double xmin = xmax - 10.0;
 //        plot->setAxisScale(QwtPlot::xBottom, xmin, xmax);
 //    }
@@ -2,17 +2,18 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QTcpSocket>
 #include <QVector>
 #include <QTimer>
 #include <qwt_plot.h>
 #include <qwt_plot_curve.h>
 #include <qwt_plot_panner.h>
+#include "mbpoller.h"
+#include "aggregator.h"
+#include "presenter.h"
+#include "history.h"
 
 namespace Ui { class MainWindow; }
 
-struct Mbap { quint16 tid; quint16 pid; quint16 len; quint8 uid; };
-
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -23,35 +24,45 @@ public:
     QVector<float> floats;
     ~MainWindow();
 
+    // Modbus/UDP 로 폴링 (연결 전에)
+    void useUdp(int retries);
+
 private slots:
     void on_addr_toggled(bool checked);
     void on_connect_clicked();
     void on_apply_clicked();
-    void onSockReadyRead();
+    void onReply(const MbReply& r);
+    void onRequestTimedOut(int item, quint16 tid);
     void onAutoApplyTimeout();
 
     void on_stop_clicked();
+    void refreshCurves();
 
 private:
     Ui::MainWindow *ui;
-    QTcpSocket* m_sock;
-    QByteArray m_cliBuf;
+    MbPoller* m_poller;
     QTimer *m_autoTimer;
     QwtPlot *plot;
-    QwtPlotCurve *curve[4];
+    enum { CURVES = 5, HISTORY_BLOCKS = 512 };  // 곡선당 최대 512 KB 압축 history
+    QwtPlotCurve *curve[CURVES];
     QwtPlotPanner *panner;
-    QVector<double> yData[4];
-    QVector<double> xData[4];
+    History* m_hist[CURVES];              // x 는 첫 응답 이후 ms
+    unsigned m_histDirty;                 // 다음 frame 에 다시 그릴 곡선 bit
+    QVector<double> m_plotX;              // decode 용 (재사용)
+    QVector<double> m_plotY;
+    Aggregator m_agg;
+    int m_aggCh[5];                       // 11107, 11201, 11217, 11225, 11153
+    Aggregator::ChannelStats m_aggStats[5];
+    enum { VIEW_STATUS, VIEW_V, VIEW_A, VIEW_KW, VIEW_KWH, VIEW_TEMP, VIEW_COUNT };
+    Presenter* m_view;                    // apply_test / label_* / signLog / 표 (frame rate 제한)
+    int m_viewId[VIEW_COUNT];
+    qint64 m_t0Ns;                        // 첫 응답 수신 시각 (plot x 기준)
 
     bool parseInputs(QString &ip, quint16 &port, int &timeoutMs, QString &err);
-    static bool takeOneModbusTcpFrame(QByteArray& buf, QByteArray& outFrame);
-    static bool parseModbusTcpFrame(const QByteArray& frame, Mbap& mb, quint8& fc, QByteArray& pdu);
-    static QVector<quint16> parseModbus03Reply(const QByteArray& rx, QString* err);
-    static QByteArray buildModbusReadReq(quint16 transId, quint8 unitId, quint16 startAddr, quint16 regCount);
-    static QByteArray buildModbusMultiReadReq(quint16 transId, quint8 unitId, QStringList Addrs, quint16 regCount);
     void sendModbusReq();
     void addPoint(double x, double y, int nReg);
     void onAddValue(double x, double y, int nReg);
+    void aggregate(qint64 tMs, const float* v, int n);
 };
 
 #endif
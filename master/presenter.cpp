@@ -0,0 +1,206 @@
+#include "presenter.h"
+#include <QTimer>
+#include <QLabel>
+#include <QLineEdit>
+#include <QTextEdit>
+#include <QTableWidget>
+#include <qwt_plot.h>
+#include <cstdio>
+#include <cstring>
+
+Presenter::Presenter(QObject *parent) :
+    QObject(parent),
+    m_timer(new QTimer(this)),
+    m_plot(0),
+    m_replot(false),
+    m_log(0),
+    m_logDropped(0),
+    m_table(0),
+    m_cellFrom(0),
+    m_cellTo(0),
+    m_painted(0),
+    m_skipped(0)
+{
+    m_buf[0] = 0;
+    m_timer->setSingleShot(true);
+    setRate(DEFAULT_HZ);
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(onFrame()));
+}
+
+void Presenter::setRate(int hz)
+{
+    m_timer->setInterval(1000 / qBound(1, hz, 60));
+}
+
+int Presenter::addTarget(QLabel* w)
+{
+    Target t;
+    t.label = w;
+    t.edit = 0;
+    t.fmt = 0;
+    memset(t.v, 0, sizeof(t.v));
+    t.dirty = false;
+    m_targets.append(t);
+    return m_targets.size() - 1;
+}
+
+int Presenter::addTarget(QLineEdit* w)
+{
+    const int id = addTarget(static_cast<QLabel*>(0));
+    m_targets[id].edit = w;
+    return id;
+}
+
+void Presenter::setValues(int target, const char* fmt, const double* v, int n)
+{
+    if (target < 0 || target >= m_targets.size()) return;
+    Target& t = m_targets[target];
+    t.fmt = fmt;
+    for (int i = 0; i < MAX_VALUES; ++i)
+        t.v[i] = i < n ? v[i] : 0.0;
+    t.dirty = true;
+    schedule();
+}
+
+void Presenter::setText(int target, const QString& text)
+{
+    if (target < 0 || target >= m_targets.size()) return;
+    Target& t = m_targets[target];
+    t.fmt = 0;
+    t.text = text;
+    t.dirty = true;
+    schedule();
+}
+
+void Presenter::replotLater()
+{
+    m_replot = true;
+    schedule();
+}
+
+void Presenter::appendLog(const QString& text, const uchar* p, int n)
+{
+    if (!m_log) return;
+    if (m_logLines.size() >= MAX_LOG_LINES) {
+        m_logLines.removeFirst();
+        ++m_logDropped;
+    }
+    LogLine line;
+    line.text = text;
+    if (p && n > 0) line.bytes = QByteArray(reinterpret_cast<const char*>(p), n);
+    m_logLines.append(line);
+    schedule();
+}
+
+void Presenter::setCells(int row, const quint16* v, int n)
+{
+    if (!m_table || row < 0 || n <= 0) return;
+    if (m_cells.size() < row + n) {
+        const int old = m_cells.size();
+        m_cells.resize(row + n);
+        m_cellsShown.resize(row + n);
+        for (int i = old; i < row + n; ++i)
+            m_cells[i] = m_cellsShown[i] = -1;
+    }
+    for (int i = 0; i < n; ++i)
+        m_cells[row + i] = v[i];
+    if (m_cellFrom == m_cellTo) {
+        m_cellFrom = row;
+        m_cellTo = row + n;
+    } else {
+        m_cellFrom = qMin(m_cellFrom, row);
+        m_cellTo = qMax(m_cellTo, row + n);
+    }
+    schedule();
+}
+
+// 바뀐 것이 있을 때만 timer 를 건다 (한가할 때 깨어나지 않음)
+void Presenter::schedule()
+{
+    if (!m_timer->isActive()) m_timer->start();
+}
+
+void Presenter::show(Target& t, const QString& s)
+{
+    if (t.label) t.label->setText(s);
+    if (t.edit) t.edit->setText(s);
+    ++m_painted;
+}
+
+static void appendHex(QString& s, const QByteArray& b)
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
+    for (int i = 0; i < b.size(); ++i) {
+        const uchar c = uchar(b[i]);
+        if (i > 0) s += QLatin1Char(' ');
+        s += QLatin1Char(hexDigits[c >> 4]);
+        s += QLatin1Char(hexDigits[c & 0x0F]);
+    }
+}
+
+// QTextEdit::append 한 번 (줄마다 append 하면 매번 layout)
+void Presenter::flushLog()
+{
+    if (m_logLines.isEmpty()) return;
+    // 줄 사이 '\n' 하나 (append 가 문단을 나눠 준다)
+    QString s;
+    if (m_logDropped > 0) {
+        s = QString("... %1 lines skipped").arg(m_logDropped);
+        m_logDropped = 0;
+    }
+    foreach (const LogLine& line, m_logLines) {
+        if (!s.isEmpty()) s += QLatin1Char('\n');
+        s += line.text;
+        appendHex(s, line.bytes);
+    }
+    m_logLines.clear();
+    m_log->append(s);
+}
+
+void Presenter::flushCells()
+{
+    const int to = qMin(m_cellTo, m_table->rowCount());
+    for (int row = m_cellFrom; row < to; ++row) {
+        if (m_cells[row] < 0) continue;
+        QTableWidgetItem* it = m_table->item(row, 0);
+        if (!it) {
+            // setRowCount 로 새로 생긴 칸
+            it = new QTableWidgetItem;
+            m_table->setItem(row, 0, it);
+        } else if (m_cellsShown[row] == m_cells[row]) {
+            continue;
+        }
+        it->setText(QString::number(m_cells[row]));
+        m_cellsShown[row] = m_cells[row];
+    }
+    m_cellFrom = m_cellTo = 0;
+}
+
+void Presenter::onFrame()
+{
+    for (int i = 0; i < m_targets.size(); ++i) {
+        Target& t = m_targets[i];
+        if (!t.dirty) continue;
+        t.dirty = false;
+        if (t.fmt) {
+            // 남는 인자는 printf 가 무시한다
+            snprintf(m_buf, sizeof(m_buf), t.fmt, t.v[0], t.v[1], t.v[2], t.v[3], t.v[4], t.v[5], t.v[6], t.v[7]);
+            if (t.shown == m_buf) { ++m_skipped; continue; }
+            t.shown = m_buf;
+            t.shownText.clear();
+            show(t, QString::fromLatin1(m_buf));
+        } else {
+            if (t.shown.isEmpty() && t.shownText == t.text) { ++m_skipped; continue; }
+            t.shown.clear();
+            t.shownText = t.text;
+            show(t, t.text);
+        }
+    }
+    if (m_log) flushLog();
+    if (m_table && m_cellFrom != m_cellTo) flushCells();
+    if (m_replot && m_plot) {
+        m_replot = false;
+        emit aboutToReplot();
+        m_plot->replot();
+    }
+}
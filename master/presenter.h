@@ -0,0 +1,97 @@
+#ifndef PRESENTER_H
+#define PRESENTER_H
+
+#include <QObject>
+#include <QVector>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+class QTimer;
+class QLabel;
+class QLineEdit;
+class QTextEdit;
+class QTableWidget;
+class QwtPlot;
+
+// 표시 갱신을 응답 속도와 분리한다.
+// 응답 처리에서는 최신 값만 저장하고, 화면은 최대 rate Hz 로 바뀐 글자만 setText 한다.
+// 숫자는 printf 형식으로 고정 버퍼에 찍으므로 QString::arg 를 매번 만들지 않는다.
+// 로그와 레지스터 표도 frame 마다 한 번, 로그는 frame 당 MAX_LOG_LINES 줄까지만 붙인다.
+class Presenter : public QObject
+{
+    Q_OBJECT
+public:
+    enum { MAX_VALUES = 8, DEFAULT_HZ = 20, MAX_LOG_LINES = 16 };
+
+    explicit Presenter(QObject *parent = 0);
+
+    void setRate(int hz);
+    int addTarget(QLabel* w);
+    int addTarget(QLineEdit* w);
+    void setPlot(QwtPlot* plot) { m_plot = plot; }
+    void setLog(QTextEdit* w) { m_log = w; }
+    void setTable(QTableWidget* w) { m_table = w; }
+
+    // fmt : double 인자만 받는 printf 형식 문자열 리터럴 (포인터를 보관)
+    void setValues(int target, const char* fmt, const double* v, int n);
+    void setValue(int target, const char* fmt, double v) { setValues(target, fmt, &v, 1); }
+    // 자주 바뀌지 않는 글자 (예외 응답 등)
+    void setText(int target, const QString& text);
+    void replotLater();
+    // 로그 한 줄 : text 뒤에 p[0..n) 을 hex 로 (hex 변환은 표시할 줄만)
+    void appendLog(const QString& text, const uchar* p = 0, int n = 0);
+    // 표 0 열의 row 부터 n 칸 (표 행 수를 넘는 칸은 버림)
+    void setCells(int row, const quint16* v, int n);
+
+    quint64 painted() const { return m_painted; }
+    quint64 skipped() const { return m_skipped; }
+
+signals:
+    // replot 직전 (plot 데이터를 이때 채우면 frame 당 한 번만 decode)
+    void aboutToReplot();
+
+private slots:
+    void onFrame();
+
+private:
+    struct Target
+    {
+        QLabel* label;
+        QLineEdit* edit;
+        const char* fmt;          // 0 이면 text 사용
+        double v[MAX_VALUES];
+        QString text;
+        QByteArray shown;         // 마지막으로 표시한 글자 (fmt 모드)
+        QString shownText;
+        bool dirty;
+    };
+    struct LogLine
+    {
+        QString text;
+        QByteArray bytes;
+    };
+
+    QVector<Target> m_targets;
+    QTimer* m_timer;
+    QwtPlot* m_plot;
+    bool m_replot;
+    QTextEdit* m_log;
+    QList<LogLine> m_logLines;    // 다음 frame 에 붙일 줄 (최근 MAX_LOG_LINES 줄)
+    int m_logDropped;
+    QTableWidget* m_table;
+    QVector<int> m_cells;         // 최신 값, -1 = 없음
+    QVector<int> m_cellsShown;    // 표에 찍은 값
+    int m_cellFrom;               // 바뀐 칸 범위 [from, to)
+    int m_cellTo;
+    char m_buf[256];
+    quint64 m_painted;
+    quint64 m_skipped;
+
+    void show(Target& t, const QString& s);
+    void flushLog();
+    void flushCells();
+    void schedule();
+};
+
+#endif // PRESENTER_H
@@ -0,0 +1,258 @@
+#include "aggregator.h"
+#include <cstring>
+#include <limits>
+
+// ---------------------------------------------------------------- RollingWindow
+
+RollingWindow::RollingWindow() :
+    m_bucketMs(1),
+    m_headId(-1),
+    m_count(0),
+    m_sum(0.0),
+    m_last(0.0)
+{
+}
+
+void RollingWindow::init(qint64 spanMs, int buckets)
+{
+    if (buckets < 1) buckets = 1;
+    m_bucketMs = qMax<qint64>(1, spanMs / buckets);
+    Bucket empty = { -1, 0, 0.0, 0.0, 0.0 };
+    m_ring.fill(empty, buckets);
+    m_headId = -1;
+    m_count = 0;
+    m_sum = 0.0;
+    m_last = 0.0;
+}
+
+// id 까지 window 를 밀고, 빠져나간 bucket 을 합계에서 뺀다
+void RollingWindow::advance(qint64 id)
+{
+    if (id <= m_headId) return;
+    const int n = m_ring.size();
+    // 첫 샘플이 n bucket 안이면 id - n + 1 이 음수가 되므로 0 부터
+    const qint64 from = (m_headId < 0 || id - m_headId > n) ? qMax<qint64>(0, id - n + 1) : m_headId + 1;
+    for (qint64 k = from; k <= id; ++k) {
+        Bucket& b = m_ring[int(k % n)];
+        if (b.id >= 0) {
+            m_count -= b.count;
+            m_sum -= b.sum;
+        }
+        b.id = k;
+        b.count = 0;
+        b.sum = 0.0;
+    }
+    m_headId = id;
+    if (m_count == 0) m_sum = 0.0;    // 누적 오차 정리
+}
+
+void RollingWindow::add(qint64 tMs, double v)
+{
+    if (m_ring.isEmpty() || tMs < 0) return;
+    const qint64 id = tMs / m_bucketMs;
+    advance(id);
+    if (id <= m_headId - m_ring.size()) return;     // window 밖 과거 샘플
+    Bucket& b = m_ring[int(id % m_ring.size())];
+    if (b.count == 0) {
+        b.min = v;
+        b.max = v;
+    } else {
+        if (v < b.min) b.min = v;
+        if (v > b.max) b.max = v;
+    }
+    ++b.count;
+    b.sum += v;
+    ++m_count;
+    m_sum += v;
+    if (id == m_headId) m_last = v;
+}
+
+void RollingWindow::stats(qint64 tMs, WindowStats& out)
+{
+    if (!m_ring.isEmpty() && tMs >= 0) advance(tMs / m_bucketMs);
+    out.count = m_count;
+    out.last = m_last;
+    if (m_count == 0) {
+        out.min = out.max = out.avg = 0.0;
+        return;
+    }
+    out.avg = m_sum / m_count;
+    out.min = std::numeric_limits<double>::max();
+    out.max = -std::numeric_limits<double>::max();
+    for (int i = 0; i < m_ring.size(); ++i) {
+        const Bucket& b = m_ring[i];
+        if (b.id < 0 || b.count == 0) continue;
+        if (b.min < out.min) out.min = b.min;
+        if (b.max > out.max) out.max = b.max;
+    }
+}
+
+double RollingWindow::sum(qint64 tMs)
+{
+    if (!m_ring.isEmpty() && tMs >= 0) advance(tMs / m_bucketMs);
+    return m_sum;
+}
+
+// ---------------------------------------------------------------- DemandMeter
+
+DemandMeter::DemandMeter() :
+    m_blockMs(1),
+    m_blockEnergy(0.0),
+    m_blockCovered(0),
+    m_lastBlock(0.0),
+    m_peak(0.0),
+    m_prevT(0),
+    m_prevKw(0.0),
+    m_havePrev(false)
+{
+}
+
+void DemandMeter::init(qint64 blockMs, int subIntervals)
+{
+    m_blockMs = qMax<qint64>(1, blockMs);
+    m_slide.init(m_blockMs, subIntervals);
+    m_blockEnergy = 0.0;
+    m_blockCovered = 0;
+    m_lastBlock = 0.0;
+    m_peak = 0.0;
+    m_havePrev = false;
+}
+
+void DemandMeter::add(qint64 tMs, double kW)
+{
+    // block 보다 긴 공백은 적분하지 않는다 (통신 두절)
+    if (m_havePrev && tMs > m_prevT && tMs - m_prevT <= m_blockMs) {
+        // 사다리꼴 적분, block 경계에서는 경계 시각까지만 현재 block 에 넣는다
+        qint64 t0 = m_prevT;
+        while (t0 < tMs) {
+            const qint64 edge = (t0 / m_blockMs + 1) * m_blockMs;
+            const qint64 t1 = qMin(edge, tMs);
+            const double k0 = m_prevKw + (kW - m_prevKw) * double(t0 - m_prevT) / double(tMs - m_prevT);
+            const double k1 = m_prevKw + (kW - m_prevKw) * double(t1 - m_prevT) / double(tMs - m_prevT);
+            const double e = 0.5 * (k0 + k1) * double(t1 - t0);
+            m_blockEnergy += e;
+            m_blockCovered += t1 - t0;
+            m_slide.add(t1 - 1, e);
+            if (t1 == edge) {
+                m_lastBlock = m_blockEnergy / double(m_blockMs);
+                if (m_lastBlock > m_peak) m_peak = m_lastBlock;
+                m_blockEnergy = 0.0;
+                m_blockCovered = 0;
+            }
+            t0 = t1;
+        }
+    } else if (m_havePrev && tMs / m_blockMs != m_prevT / m_blockMs) {
+        // 공백 뒤 다른 block : 열린 block 은 다 채우지 못했으므로 닫지 않고 버린다
+        m_blockEnergy = 0.0;
+        m_blockCovered = 0;
+    }
+    m_prevT = tMs;
+    m_prevKw = kW;
+    m_havePrev = true;
+}
+
+double DemandMeter::presentBlockDemand() const
+{
+    return m_blockCovered > 0 ? m_blockEnergy / double(m_blockCovered) : m_prevKw;
+}
+
+double DemandMeter::slidingDemand(qint64 tMs)
+{
+    return m_slide.sum(tMs) / double(m_blockMs);
+}
+
+// ---------------------------------------------------------------- EnergyDelta
+
+EnergyDelta::EnergyDelta() :
+    m_blockMs(1),
+    m_blockId(-1),
+    m_prevT(0),
+    m_prev(0.0),
+    m_havePrev(false),
+    m_blockDelta(0.0),
+    m_lastBlockDelta(0.0),
+    m_total(0.0)
+{
+}
+
+void EnergyDelta::init(qint64 blockMs)
+{
+    m_blockMs = qMax<qint64>(1, blockMs);
+    m_blockId = -1;
+    m_havePrev = false;
+    m_blockDelta = m_lastBlockDelta = m_total = 0.0;
+}
+
+void EnergyDelta::add(qint64 tMs, double kWh)
+{
+    const qint64 id = tMs / m_blockMs;
+    // block 보다 긴 공백의 증분은 어느 block 것인지 모르므로 total 에만 넣는다
+    const bool gap = m_havePrev && tMs - m_prevT > m_blockMs;
+    if (m_blockId >= 0 && id != m_blockId) {
+        // 바로 다음 block 으로 넘어갈 때만 닫고, 공백 뒤에는 열린 block 을 버린다
+        if (!gap && id == m_blockId + 1) m_lastBlockDelta = m_blockDelta;
+        m_blockDelta = 0.0;
+    }
+    m_blockId = id;
+    if (m_havePrev && kWh >= m_prev) {
+        const double d = kWh - m_prev;
+        if (!gap) m_blockDelta += d;
+        m_total += d;
+    }
+    m_prevT = tMs;
+    m_prev = kWh;
+    m_havePrev = true;
+}
+
+// ---------------------------------------------------------------- Aggregator
+
+Aggregator::Aggregator(int maxChannels) :
+    m_max(maxChannels)
+{
+    m_channels.reserve(maxChannels);
+}
+
+int Aggregator::addChannel(Kind kind)
+{
+    if (m_channels.size() >= m_max) return -1;
+    m_channels.resize(m_channels.size() + 1);
+    Channel& c = m_channels.last();
+    c.kind = kind;
+    c.sec1.init(1000, 10);
+    c.min1.init(60 * 1000, 60);
+    c.min15.init(BLOCK_MS, 90);
+    c.demand.init(BLOCK_MS, SUB_INTERVALS);
+    c.energy.init(BLOCK_MS);
+    return m_channels.size() - 1;
+}
+
+void Aggregator::add(int ch, qint64 tMs, double v)
+{
+    if (ch < 0 || ch >= m_channels.size()) return;
+    Channel& c = m_channels[ch];
+    c.sec1.add(tMs, v);
+    c.min1.add(tMs, v);
+    c.min15.add(tMs, v);
+    if (c.kind == Power) c.demand.add(tMs, v);
+    else if (c.kind == Energy) c.energy.add(tMs, v);
+}
+
+void Aggregator::stats(int ch, qint64 tMs, ChannelStats& out)
+{
+    memset(&out, 0, sizeof(out));
+    if (ch < 0 || ch >= m_channels.size()) return;
+    Channel& c = m_channels[ch];
+    c.sec1.stats(tMs, out.sec1);
+    c.min1.stats(tMs, out.min1);
+    c.min15.stats(tMs, out.min15);
+    if (c.kind == Power) {
+        out.blockDemand = c.demand.lastBlockDemand();
+        out.presentDemand = c.demand.presentBlockDemand();
+        out.slidingDemand = c.demand.slidingDemand(tMs);
+        out.peakDemand = c.demand.peakDemand();
+    } else if (c.kind == Energy) {
+        out.energyBlock = c.energy.blockDelta();
+        out.energyLastBlock = c.energy.lastBlockDelta();
+        out.energyTotal = c.energy.total();
+    }
+}
@@ -0,0 +1,141 @@
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QVector>
+
+// 디코드된 샘플의 증분 집계
+// 모든 구조는 init 시 한 번 할당하고, add() 는 bucket 하나만 갱신한다 (상각 O(1)).
+
+struct WindowStats
+{
+    int count;
+    double min;
+    double max;
+    double avg;
+    double last;
+};
+
+// spanMs 구간을 buckets 개로 나눈 rolling window (count / sum / min / max)
+class RollingWindow
+{
+public:
+    RollingWindow();
+    void init(qint64 spanMs, int buckets);
+
+    void add(qint64 tMs, double v);
+    void stats(qint64 tMs, WindowStats& out);
+    double sum(qint64 tMs);
+
+private:
+    struct Bucket
+    {
+        qint64 id;        // tMs / bucketMs, -1 = 비어 있음
+        int count;
+        double sum;
+        double min;
+        double max;
+    };
+    QVector<Bucket> m_ring;
+    qint64 m_bucketMs;
+    qint64 m_headId;      // 가장 최근 bucket id
+    int m_count;          // window 안 bucket 합계
+    double m_sum;
+    double m_last;
+
+    void advance(qint64 id);
+};
+
+// 수요전력 : 고정 block (예 15분) 과 sub-interval 단위 sliding demand
+// kW 를 사다리꼴로 적분해 kW*ms 로 모은다.
+class DemandMeter
+{
+public:
+    DemandMeter();
+    void init(qint64 blockMs, int subIntervals);
+
+    void add(qint64 tMs, double kW);
+    double lastBlockDemand() const { return m_lastBlock; }    // 직전 완료 block 평균 kW
+    double presentBlockDemand() const;                       // 진행 중 block 평균 kW
+    double slidingDemand(qint64 tMs);                        // 최근 blockMs 평균 kW
+    double peakDemand() const { return m_peak; }
+
+private:
+    RollingWindow m_slide;   // sub-interval 별 kW*ms
+    qint64 m_blockMs;
+    double m_blockEnergy;    // kW*ms
+    qint64 m_blockCovered;   // 적분된 ms
+    double m_lastBlock;
+    double m_peak;
+    qint64 m_prevT;
+    double m_prevKw;
+    bool m_havePrev;
+};
+
+// 적산 kWh 카운터의 증분. 카운터가 줄면 (리셋) 그 구간은 0 으로 본다.
+class EnergyDelta
+{
+public:
+    EnergyDelta();
+    void init(qint64 blockMs);
+
+    void add(qint64 tMs, double kWh);
+    double blockDelta() const { return m_blockDelta; }        // 진행 중 block 증분
+    double lastBlockDelta() const { return m_lastBlockDelta; }
+    double total() const { return m_total; }                  // 시작 이후 증분
+
+private:
+    qint64 m_blockMs;
+    qint64 m_blockId;
+    qint64 m_prevT;
+    double m_prev;
+    bool m_havePrev;
+    double m_blockDelta;
+    double m_lastBlockDelta;
+    double m_total;
+};
+
+// 레지스터(채널) 별 집계 묶음
+class Aggregator
+{
+public:
+    enum Kind { Instant, Power, Energy };
+
+    struct ChannelStats
+    {
+        WindowStats sec1;
+        WindowStats min1;
+        WindowStats min15;
+        double blockDemand;       // Power : 직전 block 평균 kW
+        double presentDemand;     // Power : 진행 중 block
+        double slidingDemand;     // Power : 최근 15분
+        double peakDemand;
+        double energyBlock;       // Energy : 진행 중 block kWh 증분
+        double energyLastBlock;
+        double energyTotal;
+    };
+
+    enum { BLOCK_MS = 15 * 60 * 1000, SUB_INTERVALS = 15 };
+
+    explicit Aggregator(int maxChannels = 64);
+
+    int addChannel(Kind kind);          // channel index, 가득 차면 -1
+    int channelCount() const { return m_channels.size(); }
+    void add(int ch, qint64 tMs, double v);
+    void stats(int ch, qint64 tMs, ChannelStats& out);
+
+private:
+    struct Channel
+    {
+        Kind kind;
+        RollingWindow sec1;
+        RollingWindow min1;
+        RollingWindow min15;
+        DemandMeter demand;
+        EnergyDelta energy;
+    };
+    QVector<Channel> m_channels;
+    int m_max;
+};
+
+#endif // AGGREGATOR_H
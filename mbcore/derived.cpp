@@ -0,0 +1,217 @@
+#include "derived.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const float SQ3_2 = 0.86602540378f;   // sin 120
+static const float EPS = 1e-6f;
+
+DerivedBatch::DerivedBatch() :
+    m_n(0),
+    m_stride(0)
+{
+    resize(0);
+}
+
+void DerivedBatch::resize(int n)
+{
+    m_n = n;
+    m_stride = (n + 3) & ~3;
+    m_store.fill(0.0f, (INPUTS + OUTPUTS) * m_stride + 4);
+    m_flags.fill(0, m_stride + 4);
+    float* p = m_store.data();
+    float** arrays[] = {
+        &vax, &vay, &vbx, &vby, &vcx, &vcy,
+        &iax, &iay, &ibx, &iby, &icx, &icy,
+        &meterLN, &meterLL, &meterU0, &meterU2,
+        &vA, &vB, &vC, &angA, &angB, &angC,
+        &vAB, &vBC, &vCA, &seq0, &seq1, &seq2,
+        &lnUb, &llUb, &u0Ub, &u2Ub,
+        &pfA, &pfB, &pfC
+    };
+    static_assert(sizeof(arrays) / sizeof(arrays[0]) == INPUTS + OUTPUTS, "DerivedBatch arrays");
+    for (int k = 0; k < INPUTS + OUTPUTS; ++k)
+        *arrays[k] = p + k * m_stride;
+    flags = m_flags.data();
+}
+
+void DerivedBatch::load(int i, const unit::PT3Data& d, const float* iPhasor)
+{
+    if (i < 0 || i >= m_n) return;
+    vax[i] = float(d.vphasor.a_x); vay[i] = float(d.vphasor.a_y);
+    vbx[i] = float(d.vphasor.b_x); vby[i] = float(d.vphasor.b_y);
+    vcx[i] = float(d.vphasor.c_x); vcy[i] = float(d.vphasor.c_y);
+    meterLN[i] = float(d.vub.LN_ub);
+    meterLL[i] = float(d.vub.LL_ub);
+    meterU0[i] = float(d.vub.U0_ub);
+    meterU2[i] = float(d.vub.U2_ub);
+    if (iPhasor) {
+        iax[i] = iPhasor[0]; iay[i] = iPhasor[1];
+        ibx[i] = iPhasor[2]; iby[i] = iPhasor[3];
+        icx[i] = iPhasor[4]; icy[i] = iPhasor[5];
+    } else {
+        iax[i] = iay[i] = ibx[i] = iby[i] = icx[i] = icy[i] = 0.0f;
+    }
+}
+
+// ---------------------------------------------------------------- scalar
+
+// meter 음수 = 값 없음
+static inline bool mismatch(float calc, float meter, float tol)
+{
+    return meter >= 0.0f && std::fabs(calc - meter) > tol;
+}
+
+static inline float ubPercent(float a, float b, float c)
+{
+    const float avg = (a + b + c) * (1.0f / 3.0f);
+    if (avg <= EPS) return 0.0f;
+    const float dev = std::max(std::fabs(a - avg), std::max(std::fabs(b - avg), std::fabs(c - avg)));
+    return 100.0f * dev / avg;
+}
+
+static inline float pf(float vx, float vy, float ix, float iy, float vm)
+{
+    const float s = vm * std::sqrt(ix * ix + iy * iy);
+    return s > EPS ? (vx * ix + vy * iy) / s : 0.0f;
+}
+
+static void computeLane(DerivedBatch& b, int i)
+{
+    const float ax = b.vax[i], ay = b.vay[i], bx = b.vbx[i], by = b.vby[i], cx = b.vcx[i], cy = b.vcy[i];
+    b.vA[i] = std::sqrt(ax * ax + ay * ay);
+    b.vB[i] = std::sqrt(bx * bx + by * by);
+    b.vC[i] = std::sqrt(cx * cx + cy * cy);
+
+    const float abx = ax - bx, aby = ay - by, bcx = bx - cx, bcy = by - cy, cax = cx - ax, cay = cy - ay;
+    b.vAB[i] = std::sqrt(abx * abx + aby * aby);
+    b.vBC[i] = std::sqrt(bcx * bcx + bcy * bcy);
+    b.vCA[i] = std::sqrt(cax * cax + cay * cay);
+
+    const float third = 1.0f / 3.0f;
+    const float s0x = (ax + bx + cx) * third, s0y = (ay + by + cy) * third;
+    const float s1x = (ax - 0.5f * bx - SQ3_2 * by - 0.5f * cx + SQ3_2 * cy) * third;
+    const float s1y = (ay + SQ3_2 * bx - 0.5f * by - SQ3_2 * cx - 0.5f * cy) * third;
+    const float s2x = (ax - 0.5f * bx + SQ3_2 * by - 0.5f * cx - SQ3_2 * cy) * third;
+    const float s2y = (ay - SQ3_2 * bx - 0.5f * by + SQ3_2 * cx - 0.5f * cy) * third;
+    b.seq0[i] = std::sqrt(s0x * s0x + s0y * s0y);
+    b.seq1[i] = std::sqrt(s1x * s1x + s1y * s1y);
+    b.seq2[i] = std::sqrt(s2x * s2x + s2y * s2y);
+    b.u0Ub[i] = b.seq1[i] > EPS ? 100.0f * b.seq0[i] / b.seq1[i] : 0.0f;
+    b.u2Ub[i] = b.seq1[i] > EPS ? 100.0f * b.seq2[i] / b.seq1[i] : 0.0f;
+
+    b.lnUb[i] = ubPercent(b.vA[i], b.vB[i], b.vC[i]);
+    b.llUb[i] = ubPercent(b.vAB[i], b.vBC[i], b.vCA[i]);
+
+    b.pfA[i] = pf(ax, ay, b.iax[i], b.iay[i], b.vA[i]);
+    b.pfB[i] = pf(bx, by, b.ibx[i], b.iby[i], b.vB[i]);
+    b.pfC[i] = pf(cx, cy, b.icx[i], b.icy[i], b.vC[i]);
+}
+
+// ---------------------------------------------------------------- SSE (4 대씩)
+
+#if defined(__SSE2__)
+static inline __m128 mag(__m128 x, __m128 y)
+{
+    return _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+}
+
+// den > EPS 인 lane 만 num / den, 나머지 0
+static inline __m128 safeDiv(__m128 num, __m128 den)
+{
+    const __m128 ok = _mm_cmpgt_ps(den, _mm_set1_ps(EPS));
+    return _mm_and_ps(ok, _mm_div_ps(num, _mm_max_ps(den, _mm_set1_ps(EPS))));
+}
+
+static inline __m128 abs4(__m128 x)
+{
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+}
+
+static inline __m128 ub4(__m128 a, __m128 b, __m128 c)
+{
+    const __m128 avg = _mm_mul_ps(_mm_add_ps(_mm_add_ps(a, b), c), _mm_set1_ps(1.0f / 3.0f));
+    const __m128 dev = _mm_max_ps(abs4(_mm_sub_ps(a, avg)), _mm_max_ps(abs4(_mm_sub_ps(b, avg)), abs4(_mm_sub_ps(c, avg))));
+    return _mm_mul_ps(_mm_set1_ps(100.0f), safeDiv(dev, avg));
+}
+
+static inline __m128 pf4(__m128 vx, __m128 vy, __m128 ix, __m128 iy, __m128 vm)
+{
+    const __m128 p = _mm_add_ps(_mm_mul_ps(vx, ix), _mm_mul_ps(vy, iy));
+    return safeDiv(p, _mm_mul_ps(vm, mag(ix, iy)));
+}
+
+static void computeSse(DerivedBatch& b, int i)
+{
+    const __m128 ax = _mm_loadu_ps(b.vax + i), ay = _mm_loadu_ps(b.vay + i);
+    const __m128 bx = _mm_loadu_ps(b.vbx + i), by = _mm_loadu_ps(b.vby + i);
+    const __m128 cx = _mm_loadu_ps(b.vcx + i), cy = _mm_loadu_ps(b.vcy + i);
+    const __m128 half = _mm_set1_ps(0.5f), sq = _mm_set1_ps(SQ3_2), third = _mm_set1_ps(1.0f / 3.0f);
+
+    const __m128 vA = mag(ax, ay), vB = mag(bx, by), vC = mag(cx, cy);
+    _mm_storeu_ps(b.vA + i, vA);
+    _mm_storeu_ps(b.vB + i, vB);
+    _mm_storeu_ps(b.vC + i, vC);
+
+    const __m128 vAB = mag(_mm_sub_ps(ax, bx), _mm_sub_ps(ay, by));
+    const __m128 vBC = mag(_mm_sub_ps(bx, cx), _mm_sub_ps(by, cy));
+    const __m128 vCA = mag(_mm_sub_ps(cx, ax), _mm_sub_ps(cy, ay));
+    _mm_storeu_ps(b.vAB + i, vAB);
+    _mm_storeu_ps(b.vBC + i, vBC);
+    _mm_storeu_ps(b.vCA + i, vCA);
+
+    // 대칭분 : 공통항 r = a - (b + c)/2, 회전항 = sin120 * (...)
+    const __m128 rx = _mm_sub_ps(ax, _mm_mul_ps(half, _mm_add_ps(bx, cx)));
+    const __m128 ry = _mm_sub_ps(ay, _mm_mul_ps(half, _mm_add_ps(by, cy)));
+    const __m128 qx = _mm_mul_ps(sq, _mm_sub_ps(cy, by));
+    const __m128 qy = _mm_mul_ps(sq, _mm_sub_ps(bx, cx));
+    const __m128 s0 = _mm_mul_ps(mag(_mm_add_ps(_mm_add_ps(ax, bx), cx), _mm_add_ps(_mm_add_ps(ay, by), cy)), third);
+    const __m128 s1 = _mm_mul_ps(mag(_mm_add_ps(rx, qx), _mm_add_ps(ry, qy)), third);
+    const __m128 s2 = _mm_mul_ps(mag(_mm_sub_ps(rx, qx), _mm_sub_ps(ry, qy)), third);
+    _mm_storeu_ps(b.seq0 + i, s0);
+    _mm_storeu_ps(b.seq1 + i, s1);
+    _mm_storeu_ps(b.seq2 + i, s2);
+    const __m128 hundred = _mm_set1_ps(100.0f);
+    _mm_storeu_ps(b.u0Ub + i, _mm_mul_ps(hundred, safeDiv(s0, s1)));
+    _mm_storeu_ps(b.u2Ub + i, _mm_mul_ps(hundred, safeDiv(s2, s1)));
+
+    _mm_storeu_ps(b.lnUb + i, ub4(vA, vB, vC));
+    _mm_storeu_ps(b.llUb + i, ub4(vAB, vBC, vCA));
+
+    _mm_storeu_ps(b.pfA + i, pf4(ax, ay, _mm_loadu_ps(b.iax + i), _mm_loadu_ps(b.iay + i), vA));
+    _mm_storeu_ps(b.pfB + i, pf4(bx, by, _mm_loadu_ps(b.ibx + i), _mm_loadu_ps(b.iby + i), vB));
+    _mm_storeu_ps(b.pfC + i, pf4(cx, cy, _mm_loadu_ps(b.icx + i), _mm_loadu_ps(b.icy + i), vC));
+}
+#endif
+
+void computeDerived(DerivedBatch& b, float ubTolerance)
+{
+    const int n = b.size();
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 4 <= n; i += 4)
+        computeSse(b, i);
+#endif
+    for (; i < n; ++i)
+        computeLane(b, i);
+
+    // 위상각 (atan2) 과 검증 플래그는 lane 별로
+    const float toDeg = 180.0f / 3.14159265358979f;
+    for (i = 0; i < n; ++i) {
+        b.angA[i] = std::atan2(b.vay[i], b.vax[i]) * toDeg;
+        b.angB[i] = std::atan2(b.vby[i], b.vbx[i]) * toDeg;
+        b.angC[i] = std::atan2(b.vcy[i], b.vcx[i]) * toDeg;
+        quint8 f = 0;
+        if (b.iax[i] == 0.0f && b.iay[i] == 0.0f && b.ibx[i] == 0.0f
+                && b.iby[i] == 0.0f && b.icx[i] == 0.0f && b.icy[i] == 0.0f)
+            f |= DerivedBatch::FLAG_NO_CURRENT;
+        if (mismatch(b.u2Ub[i], b.meterU2[i], ubTolerance)) f |= DerivedBatch::FLAG_U2_MISMATCH;
+        if (mismatch(b.lnUb[i], b.meterLN[i], ubTolerance)) f |= DerivedBatch::FLAG_LN_MISMATCH;
+        if (mismatch(b.llUb[i], b.meterLL[i], ubTolerance)) f |= DerivedBatch::FLAG_LL_MISMATCH;
+        if (mismatch(b.u0Ub[i], b.meterU0[i], ubTolerance)) f |= DerivedBatch::FLAG_U0_MISMATCH;
+        b.flags[i] = f;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef DERIVED_H
+#define DERIVED_H
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QVector>
+#include "unit.h"
+
+// phasor / 크기 레지스터에서 계산하는 파생 값 (미터 n 대 한 번에)
+// 입력과 출력은 structure-of-arrays 이며 computeDerived() 가 4 대씩 SIMD 로 처리한다.
+class DerivedBatch
+{
+public:
+    enum Flag {
+        FLAG_NO_CURRENT = 0x01,   // 전류 phasor 없음, pf 미계산
+        // 미터 불평형율과 계산값 차이가 허용치 초과
+        FLAG_U2_MISMATCH = 0x02,
+        FLAG_LN_MISMATCH = 0x04,
+        FLAG_LL_MISMATCH = 0x08,
+        FLAG_U0_MISMATCH = 0x10
+    };
+
+    DerivedBatch();
+
+    void resize(int n);
+    int size() const { return m_n; }
+
+    // 미터 i 입력. iPhasor 는 (a_x, a_y, b_x, b_y, c_x, c_y), 없으면 0
+    // d.vub 의 음수 항목은 미터 값 없음 (비교하지 않음)
+    void load(int i, const unit::PT3Data& d, const float* iPhasor);
+
+    // 입력
+    float *vax, *vay, *vbx, *vby, *vcx, *vcy;   // 전압 phasor
+    float *iax, *iay, *ibx, *iby, *icx, *icy;   // 전류 phasor
+    float *meterLN, *meterLL, *meterU0, *meterU2;   // 미터 VUB (%), 음수 = 값 없음
+
+    // 출력
+    float *vA, *vB, *vC;             // 상전압 크기
+    float *angA, *angB, *angC;       // 상전압 위상 (deg)
+    float *vAB, *vBC, *vCA;          // 선간전압 크기
+    float *seq0, *seq1, *seq2;       // 영상 / 정상 / 역상 크기
+    float *lnUb, *llUb;              // 최대편차 / 평균 (%)
+    float *u0Ub, *u2Ub;              // |V0|/|V1|, |V2|/|V1| (%)
+    float *pfA, *pfB, *pfC;          // 상별 역률 (P / S)
+    quint8* flags;
+
+private:
+    enum { INPUTS = 16, OUTPUTS = 19 };
+    QVector<float> m_store;
+    QVector<quint8> m_flags;
+    int m_n;
+    int m_stride;                    // 배열 하나 길이 (4 배수)
+};
+
+// ubTolerance : 미터 불평형율 (LN LL U0 U2) 과 비교 허용치 (%p)
+void computeDerived(DerivedBatch& b, float ubTolerance = 0.5f);
+
+#endif // DERIVED_H
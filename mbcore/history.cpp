@@ -0,0 +1,282 @@
+#include "history.h"
+#include <cstring>
+
+static inline quint64 toBits(double v)
+{
+    quint64 u;
+    memcpy(&u, &v, sizeof(u));
+    return u;
+}
+
+static inline double fromBits(quint64 u)
+{
+    double v;
+    memcpy(&v, &u, sizeof(v));
+    return v;
+}
+
+static inline int leadingZeros(quint64 x)
+{
+    return x ? __builtin_clzll(x) : 64;
+}
+
+static inline int trailingZeros(quint64 x)
+{
+    return x ? __builtin_ctzll(x) : 64;
+}
+
+// n bit 2 의 보수 -> 부호 확장
+static inline qint64 signExtend(quint64 v, int n)
+{
+    const quint64 m = quint64(1) << (n - 1);
+    return qint64((v ^ m) - m);
+}
+
+History::History(int maxBlocks) :
+    m_maxBlocks(qMax(1, maxBlocks)),
+    m_points(0),
+    m_prevDelta(0),
+    m_prevV(0),
+    m_prevLead(-1),
+    m_prevTrail(0)
+{
+}
+
+History::~History()
+{
+    qDeleteAll(m_blocks);
+}
+
+void History::clear()
+{
+    qDeleteAll(m_blocks);
+    m_blocks.clear();
+    m_points = 0;
+}
+
+qint64 History::firstTime() const
+{
+    return m_blocks.isEmpty() ? 0 : m_blocks.first()->t0;
+}
+
+qint64 History::lastTime() const
+{
+    return m_blocks.isEmpty() ? 0 : m_blocks.last()->tLast;
+}
+
+int History::memoryBytes() const
+{
+    return m_blocks.size() * int(sizeof(Block));
+}
+
+// MSB 부터 n bit (n <= 64)
+void History::put(Block* b, quint64 value, int n)
+{
+    if (n == 0) return;
+    if (n < 64) value &= (quint64(1) << n) - 1;
+    const int word = b->bits >> 6;
+    const int used = b->bits & 63;
+    const int room = 64 - used;
+    if (n <= room) {
+        b->w[word] |= value << (room - n);
+    } else {
+        b->w[word] |= value >> (n - room);
+        b->w[word + 1] |= value << (64 - (n - room));
+    }
+    b->bits += n;
+}
+
+History::Block* History::newBlock(qint64 tMs, quint64 v)
+{
+    Block* b;
+    if (m_blocks.size() >= m_maxBlocks) {
+        b = m_blocks.takeFirst();           // 가장 오래된 block 재사용
+        m_points -= b->count;
+    } else {
+        b = new Block;
+    }
+    memset(b->w, 0, sizeof(b->w));
+    b->t0 = b->tLast = tMs;
+    b->v0 = v;
+    b->count = 1;
+    b->bits = 0;
+    m_blocks.append(b);
+    m_prevDelta = 0;
+    m_prevV = v;
+    m_prevLead = -1;
+    return b;
+}
+
+bool History::append(qint64 tMs, double value)
+{
+    const quint64 v = toBits(value);
+    Block* b = m_blocks.isEmpty() ? 0 : m_blocks.last();
+    if (b && tMs < b->tLast) return false;
+    if (!b || b->bits + MAX_POINT_BITS > BLOCK_WORDS * 64) {
+        newBlock(tMs, v);
+        ++m_points;
+        return true;
+    }
+
+    // 시각 : delta-of-delta
+    const qint64 delta = tMs - b->tLast;
+    const qint64 dod = delta - m_prevDelta;
+    if (dod == 0) {
+        put(b, 0, 1);
+    } else if (dod >= -64 && dod <= 63) {
+        put(b, 2, 2);                       // 10
+        put(b, quint64(dod), 7);
+    } else if (dod >= -256 && dod <= 255) {
+        put(b, 6, 3);                       // 110
+        put(b, quint64(dod), 9);
+    } else if (dod >= -2048 && dod <= 2047) {
+        put(b, 14, 4);                      // 1110
+        put(b, quint64(dod), 12);
+    } else {
+        put(b, 15, 4);                      // 1111
+        put(b, quint64(dod), 64);
+    }
+    m_prevDelta = delta;
+    b->tLast = tMs;
+
+    // 값 : XOR
+    const quint64 x = v ^ m_prevV;
+    if (x == 0) {
+        put(b, 0, 1);
+    } else {
+        int lead = leadingZeros(x);
+        const int trail = trailingZeros(x);
+        if (lead > 31) lead = 31;
+        if (m_prevLead >= 0 && lead >= m_prevLead && trail >= m_prevTrail) {
+            put(b, 2, 2);                   // 10 : 이전 창 재사용
+            put(b, x >> m_prevTrail, 64 - m_prevLead - m_prevTrail);
+        } else {
+            const int len = 64 - lead - trail;
+            put(b, 3, 2);                   // 11 : 새 창
+            put(b, quint64(lead), 5);
+            put(b, quint64(len - 1), 6);
+            put(b, x >> trail, len);
+            m_prevLead = lead;
+            m_prevTrail = trail;
+        }
+    }
+    m_prevV = v;
+    ++b->count;
+    ++m_points;
+    return true;
+}
+
+int History::scan(qint64 fromMs, qint64 toMs, QVector<double>& x, QVector<double>& y, qint64 originMs) const
+{
+    x.resize(0);
+    y.resize(0);
+    Cursor c(*this, fromMs);
+    qint64 t;
+    double v;
+    while (c.next(t, v) && t <= toMs) {
+        x.append(double(t - originMs) / 1000.0);
+        y.append(v);
+    }
+    return x.size();
+}
+
+// ---------------------------------------------------------------- Cursor
+
+History::Cursor::Cursor(const History& h, qint64 fromMs) :
+    m_h(h),
+    m_from(fromMs),
+    m_block(-1),
+    m_left(0),
+    m_pos(0),
+    m_t(0),
+    m_delta(0),
+    m_v(0),
+    m_lead(0),
+    m_trail(0),
+    m_first(false)
+{
+    // from 이전에 끝나는 block 은 decode 하지 않는다
+    int b = 0;
+    while (b < h.m_blocks.size() && h.m_blocks[b]->tLast < fromMs) ++b;
+    enterBlock(b);
+}
+
+bool History::Cursor::enterBlock(int b)
+{
+    m_block = b;
+    if (b >= m_h.m_blocks.size()) {
+        m_left = 0;
+        return false;
+    }
+    const Block* blk = m_h.m_blocks[b];
+    m_left = blk->count;
+    m_pos = 0;
+    m_t = blk->t0;
+    m_delta = 0;
+    m_v = blk->v0;
+    m_first = true;
+    return true;
+}
+
+quint64 History::Cursor::bits(int n)
+{
+    const quint64* w = m_h.m_blocks[m_block]->w;
+    const int word = m_pos >> 6;
+    const int used = m_pos & 63;
+    const int room = 64 - used;
+    quint64 r;
+    if (n <= room) {
+        r = (w[word] << used) >> (64 - n);
+    } else {
+        const quint64 hi = (w[word] << used) >> used;       // 남은 room bit
+        r = (hi << (n - room)) | (w[word + 1] >> (64 - (n - room)));
+    }
+    m_pos += n;
+    return r;
+}
+
+bool History::Cursor::bit()
+{
+    return bits(1) != 0;
+}
+
+bool History::Cursor::decodeOne(qint64& tMs, double& v)
+{
+    if (m_first) {
+        m_first = false;
+    } else {
+        qint64 dod;
+        if (!bit()) dod = 0;
+        else if (!bit()) dod = signExtend(bits(7), 7);
+        else if (!bit()) dod = signExtend(bits(9), 9);
+        else if (!bit()) dod = signExtend(bits(12), 12);
+        else dod = qint64(bits(64));
+        m_delta += dod;
+        m_t += m_delta;
+
+        if (bit()) {
+            if (bit()) {
+                m_lead = int(bits(5));
+                const int len = int(bits(6)) + 1;
+                m_trail = 64 - m_lead - len;
+            }
+            const int len = 64 - m_lead - m_trail;
+            m_v ^= bits(len) << m_trail;
+        }
+    }
+    --m_left;
+    tMs = m_t;
+    v = fromBits(m_v);
+    return true;
+}
+
+bool History::Cursor::next(qint64& tMs, double& v)
+{
+    for (;;) {
+        while (m_left == 0) {
+            if (!enterBlock(m_block + 1)) return false;
+        }
+        decodeOne(tMs, v);
+        if (tMs >= m_from) return true;
+    }
+}
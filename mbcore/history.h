@@ -0,0 +1,87 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QList>
+#include <QtCore/QVector>
+
+// 압축 시계열 (Gorilla 방식)
+// 시각은 ms 정수로 delta-of-delta, 값은 직전 값과 XOR 한 뒤 의미 있는 bit 만 저장한다.
+// 1 KB 고정 block 단위로 쌓고, maxBlocks 를 넘으면 가장 오래된 block 을 버린다.
+class History
+{
+public:
+    enum { BLOCK_WORDS = 128 };              // block 당 64 bit word (1 KB)
+
+    explicit History(int maxBlocks = 128);
+    ~History();
+
+    // 시각이 앞 샘플보다 작으면 버린다 (false)
+    bool append(qint64 tMs, double v);
+    void clear();
+
+    int size() const { return m_points; }
+    bool isEmpty() const { return m_points == 0; }
+    qint64 firstTime() const;
+    qint64 lastTime() const;
+    int memoryBytes() const;
+
+    // [fromMs, toMs] 샘플을 순서대로 x = (t - originMs) / 1000 초, y 로 채운다. 개수 반환
+    // x / y 의 할당은 재사용한다.
+    int scan(qint64 fromMs, qint64 toMs, QVector<double>& x, QVector<double>& y, qint64 originMs) const;
+
+    // 순차 decode
+    class Cursor
+    {
+    public:
+        explicit Cursor(const History& h, qint64 fromMs = Q_INT64_C(-0x7FFFFFFFFFFFFFFF));
+        bool next(qint64& tMs, double& v);
+
+    private:
+        const History& m_h;
+        qint64 m_from;
+        int m_block;
+        int m_left;          // 현재 block 에서 남은 샘플
+        int m_pos;           // bit 위치
+        qint64 m_t;
+        qint64 m_delta;
+        quint64 m_v;
+        int m_lead;
+        int m_trail;
+        bool m_first;
+
+        quint64 bits(int n);
+        bool bit();
+        bool decodeOne(qint64& tMs, double& v);
+        bool enterBlock(int b);
+    };
+
+private:
+    enum { MAX_POINT_BITS = 4 + 64 + 2 + 5 + 6 + 64 };
+
+    struct Block
+    {
+        qint64 t0;
+        qint64 tLast;
+        quint64 v0;
+        int count;
+        int bits;                // 쓴 bit 수
+        quint64 w[BLOCK_WORDS];
+    };
+
+    QList<Block*> m_blocks;
+    int m_maxBlocks;
+    int m_points;
+    // 쓰기 상태 (마지막 block)
+    qint64 m_prevDelta;
+    quint64 m_prevV;
+    int m_prevLead;
+    int m_prevTrail;
+
+    Block* newBlock(qint64 tMs, quint64 v);
+    static void put(Block* b, quint64 value, int n);
+
+    Q_DISABLE_COPY(History)
+};
+
+#endif // HISTORY_H
@@ -0,0 +1,31 @@
+#include "mbclock.h"
+#include <QtCore/QDateTime>
+#if defined(Q_OS_UNIX)
+#include <time.h>
+#else
+#include <QtCore/QElapsedTimer>
+#endif
+
+namespace mb {
+
+qint64 monoNs()
+{
+#if defined(Q_OS_UNIX)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+    static QElapsedTimer clock;
+    if (!clock.isValid()) clock.start();
+    return clock.nsecsElapsed();
+#endif
+}
+
+qint64 monoToEpochMs(qint64 ns)
+{
+    // epoch ms - monotonic ms
+    static const qint64 offsetMs = QDateTime::currentMSecsSinceEpoch() - monoMs();
+    return offsetMs + ns / 1000000;
+}
+
+} // namespace mb
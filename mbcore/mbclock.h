@@ -0,0 +1,18 @@
+#ifndef MBCLOCK_H
+#define MBCLOCK_H
+
+#include <QtCore/QtGlobal>
+
+// 샘플 시각용 monotonic clock
+// 요청 송신 / 응답 수신 시각은 monoNs() 로 찍고, 저장 / 집계에는 monoToEpochMs() 로 바꾼다.
+// epoch 변환은 처음 호출 때 잡은 기준점 하나를 쓰므로 벽시계가 바뀌어도 순서가 뒤집히지 않는다.
+namespace mb {
+
+qint64 monoNs();
+inline qint64 monoMs() { return monoNs() / 1000000; }
+
+qint64 monoToEpochMs(qint64 ns);
+
+} // namespace mb
+
+#endif // MBCLOCK_H
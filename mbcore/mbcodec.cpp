@@ -0,0 +1,58 @@
+#include "mbcodec.h"
+
+namespace mb {
+
+FrameReader::FrameReader(int maxAdu) :
+    head_(0),
+    maxAdu_(maxAdu),
+    frames_(0),
+    skipped_(0)
+{
+    buf_.reserve(4 * maxAdu_);
+}
+
+void FrameReader::append(const char* data, int n)
+{
+    // 소비한 앞부분은 몰아서 한 번만 지운다
+    if (head_ > 0) {
+        if (head_ >= buf_.size()) {
+            buf_.clear();
+        } else {
+            buf_.remove(0, head_);
+        }
+        head_ = 0;
+    }
+    buf_.append(data, n);
+}
+
+bool FrameReader::next(Frame& f)
+{
+    const uchar* base = reinterpret_cast<const uchar*>(buf_.constData());
+    for (;;) {
+        const int avail = buf_.size() - head_;
+        const int total = frameLength(base + head_, avail, maxAdu_);
+        if (total == 0) return false;
+        if (total < 0) {
+            ++head_;
+            ++skipped_;
+            continue;
+        }
+        const uchar* p = base + head_;
+        head_ += total;
+        if (!parseFrame(p, total, f)) {
+            // 길이는 맞지만 내용이 틀린 프레임 : 통째로 버린 것도 건너뛴 byte 로 센다
+            skipped_ += total;
+            continue;
+        }
+        ++frames_;
+        return true;
+    }
+}
+
+void FrameReader::clear()
+{
+    buf_.clear();
+    head_ = 0;
+}
+
+} // namespace mb
@@ -0,0 +1,261 @@
+#ifndef MBCODEC_H
+#define MBCODEC_H
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QtEndian>
+#include <QtCore/QByteArray>
+#include <cstring>
+
+// Modbus TCP 코덱 (master / slave 공용)
+// 파싱 결과는 수신 버퍼를 가리키는 view 이며 복사하지 않는다.
+// 인코딩은 호출자가 준 버퍼에 직접 쓴다.
+
+namespace mb {
+
+enum {
+    MBAP_SIZE       = 7,     // tid(2) pid(2) len(2) uid(1)
+    MAX_ADU         = 260,   // MBAP 7 + PDU 253
+    MAX_READ_REGS   = 125,
+    FC_READ_HOLDING = 0x03,
+    FC_MULTI_READ   = 0x65,  // Accura 2300 다중 블록 읽기 (101)
+    FC_EXCEPTION    = 0x80
+};
+
+enum ExceptionCode {
+    EX_ILLEGAL_FUNCTION = 0x01,
+    EX_ILLEGAL_ADDRESS  = 0x02,
+    EX_ILLEGAL_VALUE    = 0x03,
+    EX_DEVICE_FAILURE   = 0x04,
+    EX_GATEWAY_PATH     = 0x0A,
+    EX_GATEWAY_TARGET   = 0x0B
+};
+
+struct Mbap { quint16 tid; quint16 pid; quint16 len; quint8 uid; };
+
+static inline quint16 rd16be(const uchar* p) { return quint16((p[0] << 8) | p[1]); }
+static inline void wr16be(uchar* p, quint16 v) { p[0] = uchar(v >> 8); p[1] = uchar(v); }
+
+static inline float pairToFloat(quint16 hi, quint16 lo, bool swap)
+{
+    quint32 u = swap ? ((quint32(lo) << 16) | hi) : ((quint32(hi) << 16) | lo);
+    float f;
+    memcpy(&f, &u, sizeof(float));
+    return f;
+}
+
+// 한 프레임 (MBAP + fc + pdu)
+struct Frame
+{
+    Mbap mb;
+    quint8 fc;          // 예외 비트 포함 원본 function code
+    const uchar* pdu;   // fc 다음 바이트
+    int pduSize;
+
+    const uchar* adu() const { return pdu - 8; }
+    int aduSize() const { return pduSize + 8; }
+    bool isException() const { return (fc & FC_EXCEPTION) != 0; }
+    quint8 function() const { return quint8(fc & ~FC_EXCEPTION); }
+    quint8 exceptionCode() const { return pduSize > 0 ? pdu[0] : 0; }
+};
+
+// big endian 레지스터 배열 view
+struct RegView
+{
+    const uchar* p;
+    int count;
+
+    quint16 at(int i) const { return rd16be(p + 2 * i); }
+    int floatCount() const { return count / 2; }
+    float floatAt(int i, bool swap = false) const { return pairToFloat(at(2 * i), at(2 * i + 1), swap); }
+};
+
+// 0x65 블록 기술자 (start, count) 배열 view
+struct BlockView
+{
+    const uchar* p;
+    int count;
+
+    quint16 start(int i) const { return rd16be(p + 4 * i); }
+    quint16 regs(int i) const { return rd16be(p + 4 * i + 2); }
+};
+
+// 버퍼 앞의 프레임 길이.
+// >0 : 완성된 프레임 길이, 0 : 데이터 부족, -1 : 헤더 불량 (1 byte 버리고 재동기)
+static inline int frameLength(const uchar* p, int n, int maxAdu = MAX_ADU)
+{
+    if (n < 6) return 0;
+    if (p[2] != 0 || p[3] != 0) return -1;          // pid
+    const int len = rd16be(p + 4);
+    if (len < 2) return -1;                         // uid + fc
+    const int total = 6 + len;
+    if (total > maxAdu) return -1;
+    return (n < total) ? 0 : total;
+}
+
+static inline bool parseFrame(const uchar* p, int n, Frame& f)
+{
+    if (n < MBAP_SIZE + 1) return false;
+    f.mb.tid = rd16be(p + 0);
+    f.mb.pid = rd16be(p + 2);
+    f.mb.len = rd16be(p + 4);
+    f.mb.uid = p[6];
+    if (f.mb.pid != 0x0000) return false;
+    if (f.mb.len < 2 || 6 + int(f.mb.len) != n) return false;
+    f.fc = p[7];
+    f.pdu = p + 8;
+    f.pduSize = n - 8;
+    if (f.isException() && f.pduSize != 1) return false;
+    return true;
+}
+
+// 03 응답 : byteCount, regs...
+static inline bool decodeReadReply(const Frame& f, RegView& regs)
+{
+    if (f.fc != FC_READ_HOLDING || f.pduSize < 1) return false;
+    const int byteCount = f.pdu[0];
+    if (f.pduSize != 1 + byteCount || (byteCount & 1)) return false;
+    regs.p = f.pdu + 1;
+    regs.count = byteCount / 2;
+    return true;
+}
+
+// 0x65 응답 : numBlocks, (start, count) * numBlocks, regs...
+static inline bool decodeMultiReadReply(const Frame& f, BlockView& blocks, RegView& regs)
+{
+    if (f.fc != FC_MULTI_READ || f.pduSize < 1) return false;
+    const int nBlocks = f.pdu[0];
+    const int dataOff = 1 + 4 * nBlocks;
+    if (nBlocks == 0 || f.pduSize < dataOff) return false;
+    blocks.p = f.pdu + 1;
+    blocks.count = nBlocks;
+    int nRegs = 0;
+    for (int i = 0; i < nBlocks; ++i)
+        nRegs += blocks.regs(i);
+    if (f.pduSize != dataOff + 2 * nRegs) return false;
+    regs.p = f.pdu + dataOff;
+    regs.count = nRegs;
+    return true;
+}
+
+// 03 요청 : start, count
+static inline bool decodeReadRequest(const Frame& f, quint16& start, quint16& count)
+{
+    if (f.fc != FC_READ_HOLDING || f.pduSize != 4) return false;
+    start = rd16be(f.pdu + 0);
+    count = rd16be(f.pdu + 2);
+    return true;
+}
+
+// 0x65 요청 : numBlocks, (start, count) * numBlocks
+static inline bool decodeMultiReadRequest(const Frame& f, BlockView& blocks)
+{
+    if (f.fc != FC_MULTI_READ || f.pduSize < 1) return false;
+    const int nBlocks = f.pdu[0];
+    if (nBlocks == 0 || f.pduSize != 1 + 4 * nBlocks) return false;
+    blocks.p = f.pdu + 1;
+    blocks.count = nBlocks;
+    return true;
+}
+
+// 인코더 : 쓴 byte 수, 버퍼 부족 시 0
+static inline int writeMbap(uchar* out, quint16 tid, quint8 uid, int pduSize)
+{
+    wr16be(out + 0, tid);
+    wr16be(out + 2, 0x0000);
+    wr16be(out + 4, quint16(1 + pduSize));
+    out[6] = uid;
+    return MBAP_SIZE;
+}
+
+static inline int encodeReadReq(uchar* out, int cap, quint16 tid, quint8 uid, quint16 start, quint16 count)
+{
+    const int total = MBAP_SIZE + 5;
+    if (cap < total) return 0;
+    writeMbap(out, tid, uid, 5);
+    out[7] = FC_READ_HOLDING;
+    wr16be(out + 8, start);
+    wr16be(out + 10, count);
+    return total;
+}
+
+static inline int encodeMultiReadReq(uchar* out, int cap, quint16 tid, quint8 uid,
+                                     const quint16* starts, int nBlocks, quint16 regCount)
+{
+    const int total = MBAP_SIZE + 2 + 4 * nBlocks;
+    if (nBlocks <= 0 || nBlocks > 255 || total > MAX_ADU || cap < total) return 0;
+    writeMbap(out, tid, uid, 2 + 4 * nBlocks);
+    out[7] = FC_MULTI_READ;
+    out[8] = uchar(nBlocks);
+    uchar* w = out + 9;
+    for (int i = 0; i < nBlocks; ++i, w += 4) {
+        wr16be(w, starts[i]);
+        wr16be(w + 2, regCount);
+    }
+    return total;
+}
+
+static inline int encodeReadReply(uchar* out, int cap, quint16 tid, quint8 uid, const quint16* regs, int nRegs)
+{
+    const int total = MBAP_SIZE + 2 + 2 * nRegs;
+    if (nRegs < 0 || nRegs > MAX_READ_REGS || cap < total) return 0;
+    writeMbap(out, tid, uid, 2 + 2 * nRegs);
+    out[7] = FC_READ_HOLDING;
+    out[8] = uchar(2 * nRegs);
+    for (int i = 0; i < nRegs; ++i)
+        wr16be(out + 9 + 2 * i, regs[i]);
+    return total;
+}
+
+static inline int encodeMultiReadReply(uchar* out, int cap, quint16 tid, quint8 uid,
+                                       const BlockView& blocks, const quint16* regs, int nRegs)
+{
+    const int descSize = 4 * blocks.count;
+    const int total = MBAP_SIZE + 2 + descSize + 2 * nRegs;
+    if (blocks.count <= 0 || blocks.count > 255 || total > MAX_ADU || cap < total) return 0;
+    writeMbap(out, tid, uid, 2 + descSize + 2 * nRegs);
+    out[7] = FC_MULTI_READ;
+    out[8] = uchar(blocks.count);
+    memcpy(out + 9, blocks.p, descSize);
+    uchar* w = out + 9 + descSize;
+    for (int i = 0; i < nRegs; ++i)
+        wr16be(w + 2 * i, regs[i]);
+    return total;
+}
+
+static inline int encodeException(uchar* out, int cap, quint16 tid, quint8 uid, quint8 fc, quint8 code)
+{
+    const int total = MBAP_SIZE + 2;
+    if (cap < total) return 0;
+    writeMbap(out, tid, uid, 2);
+    out[7] = uchar(fc | FC_EXCEPTION);
+    out[8] = code;
+    return total;
+}
+
+// TCP 스트림 재조립
+// next() 가 돌려준 Frame 은 다음 append() 전까지만 유효하다.
+class FrameReader
+{
+public:
+    explicit FrameReader(int maxAdu = MAX_ADU);
+
+    void append(const char* data, int n);
+    void append(const QByteArray& data) { append(data.constData(), data.size()); }
+    bool next(Frame& f);
+    void clear();
+
+    int pending() const { return buf_.size() - head_; }
+    quint64 frames() const { return frames_; }
+    quint64 resyncBytes() const { return skipped_; }
+
+private:
+    QByteArray buf_;
+    int head_;
+    int maxAdu_;
+    quint64 frames_;
+    quint64 skipped_;
+};
+
+} // namespace mb
+
+#endif // MBCODEC_H
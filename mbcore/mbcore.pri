@@ -0,0 +1,7 @@
+# mbcore 정적 라이브러리 링크 (master / slave 의 .pro 에서 include)
+
+INCLUDEPATH += $$PWD
+DEPENDPATH  += $$PWD
+
+LIBS           += -L$$OUT_PWD/../mbcore -lmbcore
+PRE_TARGETDEPS += $$OUT_PWD/../mbcore/libmbcore.a
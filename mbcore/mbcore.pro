@@ -0,0 +1,41 @@
+#-------------------------------------------------
+#
+# master / slave 공용 Modbus 라이브러리
+#
+#-------------------------------------------------
+
+QT       += core network
+QT       -= gui
+
+CONFIG += c++11 staticlib
+
+QMAKE_CXXFLAGS += -std=gnu++11
+
+TARGET = mbcore
+TEMPLATE = lib
+
+
+SOURCES += mbcodec.cpp\
+        mbclock.cpp\
+        mbpoller.cpp\
+        regcache.cpp\
+        aggregator.cpp\
+        derived.cpp\
+        snapshot.cpp\
+        metrics.cpp\
+        metricsserver.cpp\
+        history.cpp\
+        udpendpoint.cpp
+
+HEADERS  += mbcodec.h\
+        mbclock.h\
+        mbpoller.h\
+        regcache.h\
+        aggregator.h\
+        derived.h\
+        snapshot.h\
+        metrics.h\
+        metricsserver.h\
+        history.h\
+        udpendpoint.h\
+        unit.h
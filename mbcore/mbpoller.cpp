@@ -0,0 +1,347 @@
+#include "mbpoller.h"
+#include <QHostAddress>
+#include <cstring>
+
+MbPoller::MbPoller(QObject *parent) :
+    QObject(parent),
+    m_transport(TCP),
+    m_sock(new QTcpSocket(this)),
+    m_udp(new UdpEndpoint(this)),
+    m_pollTimer(new QTimer(this)),
+    m_tickTimer(new QTimer(this)),
+    m_inFlight(0),
+    m_nextTid(1),
+    m_lastTid(0),
+    m_timeoutMs(1000),
+    m_retries(0),
+    m_badDatagramBytes(0),
+    m_reconnectMs(3000),
+    m_port(0),
+    m_autoReconnect(false),
+    m_resyncSeen(0)
+{
+    memset(m_pending, 0, sizeof(m_pending));
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    connect(m_sock, SIGNAL(connected()), this, SLOT(onConnected()));
+    connect(m_sock, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+    connect(m_sock, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(m_udp, SIGNAL(datagram(const uchar*,int,UdpPeer,qint64)), this, SLOT(onDatagram(const uchar*,int,UdpPeer,qint64)));
+    connect(m_pollTimer, SIGNAL(timeout()), this, SLOT(poll()));
+    connect(m_tickTimer, SIGNAL(timeout()), this, SLOT(onTick()));
+    m_tickTimer->start(100);
+}
+
+void MbPoller::attachMetrics(const QByteArray& labels)
+{
+    metrics::Registry& reg = metrics::Registry::global();
+    Metrics* m = new Metrics;
+    m->requests = reg.counter("mb_requests_total", "Modbus requests sent", labels);
+    m->replies = reg.counter("mb_replies_total", "Modbus replies matched to a request", labels);
+    m->timeouts = reg.counter("mb_timeouts_total", "Requests without reply within the timeout", labels);
+    m->retries = reg.counter("mb_retries_total", "UDP requests sent again after a timeout", labels);
+    m->unmatched = reg.counter("mb_unmatched_total", "Replies with unknown TID", labels);
+    m->exceptions = reg.counter("mb_exceptions_total", "Exception replies", labels);
+    m->resyncBytes = reg.counter("mb_resync_bytes_total", "Bytes skipped while resyncing the frame stream", labels);
+    m->bytesIn = reg.counter("mb_rx_bytes_total", "Bytes received", labels);
+    m->bytesOut = reg.counter("mb_tx_bytes_total", "Bytes sent", labels);
+    m->reconnects = reg.counter("mb_connects_total", "TCP connections established", labels);
+    m->inFlight = reg.gauge("mb_in_flight", "Requests waiting for a reply", labels);
+    m->connected = reg.gauge("mb_connected", "1 if the TCP connection is up", labels);
+    m->rtt = reg.histogram("mb_rtt_seconds", "Request to reply round trip time", labels);
+    m_metrics.reset(m);
+}
+
+void MbPoller::setRetries(int n)
+{
+    m_retries = qBound(0, n, 255);
+    if (m_retries > 0 && m_resend.isEmpty())
+        m_resend.resize(MAX_IN_FLIGHT * mb::MAX_ADU);
+}
+
+bool MbPoller::isConnected() const
+{
+    if (m_transport == UDP) return m_udp->isOpen();
+    return m_sock->state() == QAbstractSocket::ConnectedState;
+}
+
+bool MbPoller::connectBlocking(const QString& host, quint16 port, int timeoutMs, QString* err)
+{
+    m_autoReconnect = false;
+    if (m_sock->state() != QAbstractSocket::UnconnectedState)
+        m_sock->abort();
+    m_udp->close();
+    m_host = host;
+    m_port = port;
+    if (m_transport == UDP) {
+        // 연결 절차 없음 : 주소만 고정
+        if (!m_udp->connectTo(host, port, err)) return false;
+        onConnected();
+        return true;
+    }
+    m_sock->connectToHost(host, port);
+    if (!m_sock->waitForConnected(timeoutMs)) {
+        if (err) *err = m_sock->errorString();
+        return false;
+    }
+    return true;
+}
+
+void MbPoller::start(const QString& host, quint16 port, int pollMs, int reconnectMs)
+{
+    m_host = host;
+    m_port = port;
+    m_reconnectMs = reconnectMs;
+    m_autoReconnect = true;
+    if (pollMs > 0)
+        m_pollTimer->start(pollMs);
+    reconnect();
+}
+
+void MbPoller::stop()
+{
+    m_autoReconnect = false;
+    m_pollTimer->stop();
+    m_sock->abort();
+    if (m_udp->isOpen()) {
+        m_udp->close();
+        onDisconnected();
+    }
+    clearPending();
+}
+
+void MbPoller::reconnect()
+{
+    if (!m_autoReconnect) return;
+    if (m_transport == UDP) {
+        if (m_udp->isOpen()) return;
+        QString err;
+        if (m_udp->connectTo(m_host, m_port, &err)) onConnected();
+        else QTimer::singleShot(m_reconnectMs, this, SLOT(reconnect()));
+        return;
+    }
+    if (m_sock->state() != QAbstractSocket::UnconnectedState) return;
+    m_sock->connectToHost(m_host, m_port);
+}
+
+void MbPoller::onConnected()
+{
+    m_reader.clear();
+    m_resyncSeen = resyncBytes();
+    if (m_metrics) {
+        m_metrics->reconnects->add();
+        m_metrics->connected->set(1);
+    }
+    emit connected();
+}
+
+void MbPoller::onDisconnected()
+{
+    clearPending();
+    if (m_metrics) m_metrics->connected->set(0);
+    emit disconnected();
+    if (m_autoReconnect)
+        QTimer::singleShot(m_reconnectMs, this, SLOT(reconnect()));
+}
+
+void MbPoller::clearPending()
+{
+    memset(m_pending, 0, sizeof(m_pending));
+    m_itemBusy.fill(false);
+    m_inFlight = 0;
+    if (m_metrics) m_metrics->inFlight->set(0);
+}
+
+int MbPoller::transmit(const uchar* req, int len, int item, uchar* raw)
+{
+    if (len <= 0 || !isConnected()) return 0;
+    const quint16 tid = mb::rd16be(req);
+    Pending& p = m_pending[tid % MAX_IN_FLIGHT];
+    if (p.used) { ++m_nextTid; return 0; }
+    p.used = true;
+    p.tid = tid;
+    m_lastTid = tid;
+    p.item = item;
+    p.sentNs = mb::monoNs();
+    p.lastNs = p.sentNs;
+    p.len = quint16(len);
+    p.tries = 0;
+    ++m_inFlight;
+    ++m_nextTid;
+    if (item >= 0) m_itemBusy[item] = true;
+
+    if (m_transport == UDP) {
+        if (m_retries > 0)
+            memcpy(m_resend.data() + (tid % MAX_IN_FLIGHT) * mb::MAX_ADU, req, len);
+        m_udp->queue(req, len);
+    } else {
+        m_sock->write(reinterpret_cast<const char*>(req), len);
+    }
+    m_stats.requests++;
+    m_stats.bytesOut += len;
+    if (m_metrics) {
+        m_metrics->requests->add();
+        m_metrics->bytesOut->add(len);
+        m_metrics->inFlight->set(m_inFlight);
+    }
+    if (raw) memcpy(raw, req, len);
+    return len;
+}
+
+int MbPoller::sendRead(quint8 uid, quint16 start, quint16 count, uchar* raw)
+{
+    uchar req[mb::MAX_ADU];
+    const int len = mb::encodeReadReq(req, sizeof(req), m_nextTid, uid, start, count);
+    const int n = transmit(req, len, -1, raw);
+    if (n) flushOut();
+    return n;
+}
+
+int MbPoller::sendMultiRead(quint8 uid, const quint16* starts, int nBlocks, quint16 regCount, uchar* raw)
+{
+    uchar req[mb::MAX_ADU];
+    const int len = mb::encodeMultiReadReq(req, sizeof(req), m_nextTid, uid, starts, nBlocks, regCount);
+    const int n = transmit(req, len, -1, raw);
+    if (n) flushOut();
+    return n;
+}
+
+int MbPoller::sendItem(int item, uchar* raw)
+{
+    const MbPollItem& it = m_items[item];
+    uchar req[mb::MAX_ADU];
+    int len;
+    if (it.starts.size() == 1)
+        len = mb::encodeReadReq(req, sizeof(req), m_nextTid, it.uid, it.starts[0], it.regCount);
+    else
+        len = mb::encodeMultiReadReq(req, sizeof(req), m_nextTid, it.uid, it.starts.constData(), it.starts.size(), it.regCount);
+    return transmit(req, len, item, raw);
+}
+
+void MbPoller::poll()
+{
+    if (!isConnected()) return;
+    if (m_itemBusy.size() != m_items.size())
+        m_itemBusy.fill(false, m_items.size());
+    bool sent = false;
+    for (int i = 0; i < m_items.size(); ++i) {
+        if (m_itemBusy[i]) continue;        // 이전 요청 응답 대기 중
+        if (sendItem(i, 0)) sent = true;
+    }
+    if (sent) flushOut();
+}
+
+// TCP 는 socket buffer, UDP 는 모은 datagram 을 sendmmsg 한 번으로
+void MbPoller::flushOut()
+{
+    if (m_transport == UDP) m_udp->flush();
+    else m_sock->flush();
+}
+
+void MbPoller::onReadyRead()
+{
+    // 이번에 읽은 frame 은 모두 같은 수신 시각
+    const qint64 rxNs = mb::monoNs();
+    const QByteArray data = m_sock->readAll();
+    m_stats.bytesIn += data.size();
+    if (m_metrics) m_metrics->bytesIn->add(data.size());
+    m_reader.append(data);
+    mb::Frame f;
+    while (m_reader.next(f))
+        dispatch(f, rxNs);
+    if (m_metrics && resyncBytes() != m_resyncSeen) {
+        m_metrics->resyncBytes->add(resyncBytes() - m_resyncSeen);
+        m_resyncSeen = resyncBytes();
+    }
+}
+
+// rxNs 는 커널 수신 시각 (있으면)
+void MbPoller::onDatagram(const uchar* p, int n, const UdpPeer& from, qint64 rxNs)
+{
+    Q_UNUSED(from);     // connectTo 한 상대만 온다
+    m_stats.bytesIn += n;
+    if (m_metrics) m_metrics->bytesIn->add(n);
+    mb::Frame f;
+    if (mb::frameLength(p, n) != n || !mb::parseFrame(p, n, f)) {
+        m_badDatagramBytes += n;
+        if (m_metrics) m_metrics->resyncBytes->add(n);
+        m_resyncSeen = resyncBytes();
+        return;
+    }
+    dispatch(f, rxNs);
+}
+
+void MbPoller::dispatch(const mb::Frame& f, qint64 rxNs)
+{
+    Pending& p = m_pending[f.mb.tid % MAX_IN_FLIGHT];
+    if (!p.used || p.tid != f.mb.tid) {
+        // timeout 뒤 온 응답. UDP 재전송은 같은 TID 라 먼저 온 응답이 짝이 되고 나머지가 여기
+        m_stats.unmatched++;
+        if (m_metrics) m_metrics->unmatched->add();
+        return;
+    }
+    p.used = false;
+    --m_inFlight;
+    m_stats.replies++;
+    MbReply r;
+    r.frame = f;
+    r.item = p.item;
+    if (r.item >= 0 && r.item < m_itemBusy.size()) m_itemBusy[r.item] = false;
+    r.sentNs = p.sentNs;
+    r.rxNs = rxNs;
+    r.rttUs = (rxNs - p.sentNs) / 1000;
+    r.tries = p.tries;
+    if (m_metrics) {
+        m_metrics->replies->add();
+        m_metrics->inFlight->set(m_inFlight);
+        m_metrics->rtt->observeUs(r.rttUs);
+        if (r.frame.isException()) m_metrics->exceptions->add();
+    }
+
+    mb::BlockView blocks;
+    r.regs.p = 0;
+    r.regs.count = 0;
+    if (!r.frame.isException()) {
+        if (!mb::decodeReadReply(r.frame, r.regs) && !mb::decodeMultiReadReply(r.frame, blocks, r.regs)) {
+            r.regs.p = 0;
+            r.regs.count = 0;
+        }
+    }
+    emit replyReady(r);
+}
+
+void MbPoller::onTick()
+{
+    if (m_inFlight == 0) return;
+    const qint64 now = mb::monoNs();
+    const qint64 timeoutNs = qint64(m_timeoutMs) * 1000000;
+    bool resent = false;
+    for (int i = 0; i < MAX_IN_FLIGHT; ++i) {
+        Pending& p = m_pending[i];
+        if (!p.used || now - p.lastNs < timeoutNs) continue;
+        if (m_transport == UDP && p.tries < m_retries && m_udp->isOpen()) {
+            // 같은 TID 로 다시. RTT 는 계속 첫 송신부터 (늦게 온 첫 응답을 짧게 재지 않도록)
+            ++p.tries;
+            p.lastNs = now;
+            m_udp->queue(reinterpret_cast<const uchar*>(m_resend.constData()) + i * mb::MAX_ADU, p.len);
+            resent = true;
+            m_stats.retries++;
+            m_stats.bytesOut += p.len;
+            if (m_metrics) {
+                m_metrics->retries->add();
+                m_metrics->bytesOut->add(p.len);
+            }
+            continue;
+        }
+        p.used = false;
+        --m_inFlight;
+        m_stats.timeouts++;
+        if (m_metrics) {
+            m_metrics->timeouts->add();
+            m_metrics->inFlight->set(m_inFlight);
+        }
+        if (p.item >= 0 && p.item < m_itemBusy.size()) m_itemBusy[p.item] = false;
+        emit requestTimedOut(p.item, p.tid);
+    }
+    if (resent) m_udp->flush();
+}
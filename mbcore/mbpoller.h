@@ -0,0 +1,160 @@
+#ifndef MBPOLLER_H
+#define MBPOLLER_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QVector>
+#include <QScopedPointer>
+#include "mbcodec.h"
+#include "mbclock.h"
+#include "metrics.h"
+#include "udpendpoint.h"
+
+// 폴링 항목 : 03 (블록 1개) 또는 0x65 (블록 여러 개) 요청 하나
+struct MbPollItem
+{
+    quint8 uid;
+    QVector<quint16> starts;   // 0 기반 시작 주소
+    quint16 regCount;          // 블록당 레지스터 수
+};
+
+// 응답 하나. frame / regs 는 수신 버퍼 view 이며 시그널 처리 중에만 유효하다.
+// 시각은 mb::monoNs() 기준
+struct MbReply
+{
+    int item;          // 폴링 항목 index, 단발 요청은 -1
+    mb::Frame frame;
+    mb::RegView regs;  // 예외 응답이면 count == 0
+    qint64 sentNs;     // 요청 첫 송신
+    qint64 rxNs;       // 응답 수신 (readyRead 시점)
+    qint64 rttUs;      // 첫 송신부터 (UDP 재전송은 같은 TID 라 어느 송신의 응답인지 모름)
+    int tries;         // UDP 재전송 횟수, 0 = 첫 송신만
+};
+
+struct MbPollerStats
+{
+    quint64 requests;
+    quint64 replies;
+    quint64 timeouts;
+    quint64 retries;
+    quint64 unmatched;
+    quint64 bytesIn;
+    quint64 bytesOut;
+};
+
+// Modbus TCP / UDP 요청/응답 엔진
+// TID 로 응답을 요청과 짝짓고, 응답 없는 요청은 timeoutMs 후 버린다.
+// UDP 는 datagram 하나가 ADU 하나이고, timeout 된 요청을 같은 TID 로 retries 번까지 다시 보낸다.
+class MbPoller : public QObject
+{
+    Q_OBJECT
+public:
+    enum Transport { TCP, UDP };
+
+    explicit MbPoller(QObject *parent = 0);
+
+    // 연결 전에 정한다
+    void setTransport(Transport t) { m_transport = t; }
+    Transport transport() const { return m_transport; }
+    void setRetries(int n);
+    void setTimeout(int ms) { m_timeoutMs = ms; }
+    // metrics::Registry::global() 에 mb_* 지표를 labels 로 등록하고 갱신한다
+    void attachMetrics(const QByteArray& labels);
+    void setItems(const QVector<MbPollItem>& items) { m_items = items; }
+    const QVector<MbPollItem>& items() const { return m_items; }
+
+    // GUI 용 동기 연결
+    bool connectBlocking(const QString& host, quint16 port, int timeoutMs, QString* err);
+    // 비동기 연결, 끊기면 reconnectMs 후 재연결. pollMs <= 0 이면 주기 폴링 없음
+    void start(const QString& host, quint16 port, int pollMs, int reconnectMs = 3000);
+    void stop();
+
+    bool isConnected() const;
+    int inFlight() const { return m_inFlight; }
+    quint16 lastTid() const { return m_lastTid; }
+    const MbPollerStats& stats() const { return m_stats; }
+    quint64 resyncBytes() const { return m_reader.resyncBytes() + m_badDatagramBytes; }
+
+    // 단발 요청, 보낸 ADU 를 raw 로 돌려준다 (로그용). 실패 시 0
+    int sendRead(quint8 uid, quint16 start, quint16 count, uchar* raw = 0);
+    int sendMultiRead(quint8 uid, const quint16* starts, int nBlocks, quint16 regCount, uchar* raw = 0);
+
+public slots:
+    void poll();
+
+signals:
+    void connected();
+    void disconnected();
+    void replyReady(const MbReply& reply);
+    void requestTimedOut(int item, quint16 tid);
+
+private slots:
+    void onConnected();
+    void onDisconnected();
+    void onReadyRead();
+    void onDatagram(const uchar* p, int n, const UdpPeer& from, qint64 rxNs);
+    void onTick();
+    void reconnect();
+
+private:
+    struct Pending
+    {
+        bool used;
+        quint16 tid;
+        int item;
+        qint64 sentNs;     // 첫 송신 (RTT 기준)
+        qint64 lastNs;     // 마지막 송신 (timeout 기준, 재전송 포함)
+        quint16 len;       // UDP 재전송용 ADU 길이
+        quint8 tries;
+    };
+    enum { MAX_IN_FLIGHT = 256 };
+    struct Metrics
+    {
+        metrics::Counter* requests;
+        metrics::Counter* replies;
+        metrics::Counter* timeouts;
+        metrics::Counter* retries;
+        metrics::Counter* unmatched;
+        metrics::Counter* exceptions;
+        metrics::Counter* resyncBytes;
+        metrics::Counter* bytesIn;
+        metrics::Counter* bytesOut;
+        metrics::Counter* reconnects;
+        metrics::Gauge* inFlight;
+        metrics::Gauge* connected;
+        metrics::Histogram* rtt;
+    };
+
+    Transport m_transport;
+    QTcpSocket* m_sock;
+    UdpEndpoint* m_udp;
+    QTimer* m_pollTimer;
+    QTimer* m_tickTimer;
+    mb::FrameReader m_reader;
+    QVector<MbPollItem> m_items;
+    QVector<bool> m_itemBusy;
+    Pending m_pending[MAX_IN_FLIGHT];
+    int m_inFlight;
+    quint16 m_nextTid;
+    quint16 m_lastTid;
+    int m_timeoutMs;
+    int m_retries;
+    QByteArray m_resend;                 // UDP : MAX_IN_FLIGHT * MAX_ADU, TID 슬롯별 요청
+    quint64 m_badDatagramBytes;          // UDP : 깨진 datagram 은 통째로 버림
+    int m_reconnectMs;
+    QString m_host;
+    quint16 m_port;
+    bool m_autoReconnect;
+    MbPollerStats m_stats;
+    QScopedPointer<Metrics> m_metrics;   // attachMetrics 전에는 0
+    quint64 m_resyncSeen;
+
+    int sendItem(int item, uchar* raw);
+    int transmit(const uchar* req, int len, int item, uchar* raw);
+    void flushOut();
+    void dispatch(const mb::Frame& f, qint64 rxNs);
+    void clearPending();
+};
+
+#endif // MBPOLLER_H
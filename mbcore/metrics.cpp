@@ -0,0 +1,195 @@
+#include "metrics.h"
+#include <cstdio>
+
+namespace metrics {
+
+int cellIndex()
+{
+    static std::atomic<int> next(0);
+    static thread_local int idx = next.fetch_add(1) % CELLS;
+    return idx;
+}
+
+// ---------------------------------------------------------------- Counter
+
+Counter::Counter()
+{
+    for (int i = 0; i < CELLS; ++i)
+        m_cells[i].v.store(0);
+}
+
+quint64 Counter::value() const
+{
+    quint64 sum = 0;
+    for (int i = 0; i < CELLS; ++i)
+        sum += m_cells[i].v.load(std::memory_order_relaxed);
+    return sum;
+}
+
+// ---------------------------------------------------------------- Histogram
+
+const quint32 Histogram::BOUND_US[BOUNDS] = {
+    500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 5000000
+};
+
+Histogram::Histogram()
+{
+    for (int i = 0; i < CELLS; ++i) {
+        for (int b = 0; b <= BOUNDS; ++b)
+            m_cells[i].buckets[b].store(0);
+        m_cells[i].count.store(0);
+        m_cells[i].sumUs.store(0);
+    }
+}
+
+void Histogram::observeUs(qint64 us)
+{
+    if (us < 0) us = 0;
+    int b = 0;
+    while (b < BOUNDS && quint64(us) > BOUND_US[b]) ++b;
+    Cell& c = m_cells[cellIndex()];
+    c.buckets[b].fetch_add(1, std::memory_order_relaxed);
+    c.count.fetch_add(1, std::memory_order_relaxed);
+    c.sumUs.fetch_add(quint64(us), std::memory_order_relaxed);
+}
+
+void Histogram::snapshot(quint64* buckets, quint64& count, quint64& sumUs) const
+{
+    count = 0;
+    sumUs = 0;
+    for (int b = 0; b <= BOUNDS; ++b)
+        buckets[b] = 0;
+    for (int i = 0; i < CELLS; ++i) {
+        const Cell& c = m_cells[i];
+        for (int b = 0; b <= BOUNDS; ++b)
+            buckets[b] += c.buckets[b].load(std::memory_order_relaxed);
+        count += c.count.load(std::memory_order_relaxed);
+        sumUs += c.sumUs.load(std::memory_order_relaxed);
+    }
+}
+
+// ---------------------------------------------------------------- Registry
+
+Registry& Registry::global()
+{
+    static Registry r;
+    return r;
+}
+
+Registry::~Registry()
+{
+    foreach (Family* f, m_families) {
+        foreach (const Series& s, f->series) {
+            if (f->type == TCounter) delete static_cast<Counter*>(s.metric);
+            else if (f->type == TGauge) delete static_cast<Gauge*>(s.metric);
+            else delete static_cast<Histogram*>(s.metric);
+        }
+        delete f;
+    }
+}
+
+void* Registry::find(const char* name, const char* help, Type type, const QByteArray& labels)
+{
+    QMutexLocker lock(&m_lock);
+    Family* fam = 0;
+    foreach (Family* f, m_families) {
+        if (f->name == name) { fam = f; break; }
+    }
+    if (!fam) {
+        fam = new Family;
+        fam->name = name;
+        fam->help = help;
+        fam->type = type;
+        m_families.append(fam);
+    }
+    if (fam->type != type) return 0;
+    foreach (const Series& s, fam->series) {
+        if (s.labels == labels) return s.metric;
+    }
+    Series s;
+    s.labels = labels;
+    if (type == TCounter) s.metric = new Counter;
+    else if (type == TGauge) s.metric = new Gauge;
+    else s.metric = new Histogram;
+    fam->series.append(s);
+    return s.metric;
+}
+
+Counter* Registry::counter(const char* name, const char* help, const QByteArray& labels)
+{
+    return static_cast<Counter*>(find(name, help, TCounter, labels));
+}
+
+Gauge* Registry::gauge(const char* name, const char* help, const QByteArray& labels)
+{
+    return static_cast<Gauge*>(find(name, help, TGauge, labels));
+}
+
+Histogram* Registry::histogram(const char* name, const char* help, const QByteArray& labels)
+{
+    return static_cast<Histogram*>(find(name, help, THistogram, labels));
+}
+
+// name{labels,extra} value
+static void line(QByteArray& out, const QByteArray& name, const char* suffix,
+                 const QByteArray& labels, const char* extra, const char* value)
+{
+    out += name;
+    out += suffix;
+    if (!labels.isEmpty() || extra) {
+        out += '{';
+        out += labels;
+        if (extra) {
+            if (!labels.isEmpty()) out += ',';
+            out += extra;
+        }
+        out += '}';
+    }
+    out += ' ';
+    out += value;
+    out += '\n';
+}
+
+QByteArray Registry::render() const
+{
+    static const char* const TYPE_NAME[] = { "counter", "gauge", "histogram" };
+    QMutexLocker lock(&m_lock);
+    QByteArray out;
+    out.reserve(4096);
+    char v[64];
+    char le[32];
+    foreach (const Family* f, m_families) {
+        out += "# HELP " + f->name + ' ' + f->help + '\n';
+        out += "# TYPE " + f->name + ' ' + TYPE_NAME[f->type] + '\n';
+        foreach (const Series& s, f->series) {
+            if (f->type == TCounter) {
+                snprintf(v, sizeof(v), "%llu", (unsigned long long)static_cast<const Counter*>(s.metric)->value());
+                line(out, f->name, "", s.labels, 0, v);
+            } else if (f->type == TGauge) {
+                snprintf(v, sizeof(v), "%lld", (long long)static_cast<const Gauge*>(s.metric)->value());
+                line(out, f->name, "", s.labels, 0, v);
+            } else {
+                quint64 buckets[Histogram::BOUNDS + 1];
+                quint64 count, sumUs;
+                static_cast<const Histogram*>(s.metric)->snapshot(buckets, count, sumUs);
+                quint64 cum = 0;
+                for (int b = 0; b <= Histogram::BOUNDS; ++b) {
+                    cum += buckets[b];
+                    if (b < Histogram::BOUNDS)
+                        snprintf(le, sizeof(le), "le=\"%g\"", Histogram::BOUND_US[b] / 1e6);
+                    else
+                        snprintf(le, sizeof(le), "le=\"+Inf\"");
+                    snprintf(v, sizeof(v), "%llu", (unsigned long long)cum);
+                    line(out, f->name, "_bucket", s.labels, le, v);
+                }
+                snprintf(v, sizeof(v), "%.6f", sumUs / 1e6);
+                line(out, f->name, "_sum", s.labels, 0, v);
+                snprintf(v, sizeof(v), "%llu", (unsigned long long)count);
+                line(out, f->name, "_count", s.labels, 0, v);
+            }
+        }
+    }
+    return out;
+}
+
+} // namespace metrics
@@ -0,0 +1,112 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <atomic>
+
+// Prometheus text 형식 counter / gauge / histogram
+// 값은 스레드별 cache line 크기 cell 에 relaxed atomic 으로 더하고, scrape 때만 합친다.
+
+namespace metrics {
+
+enum { CELLS = 16, CACHE_LINE = 64 };
+
+int cellIndex();    // 현재 스레드의 cell
+
+// C++11 new 는 64 byte 정렬을 보장하지 않으므로 heap 에 둘 때 정렬 할당
+#define METRICS_ALIGNED_NEW \
+    static void* operator new(size_t n) { return qMallocAligned(n, CACHE_LINE); } \
+    static void operator delete(void* p) { qFreeAligned(p); }
+
+class Counter
+{
+public:
+    Counter();
+    METRICS_ALIGNED_NEW
+    void add(quint64 n = 1) { m_cells[cellIndex()].v.fetch_add(n, std::memory_order_relaxed); }
+    quint64 value() const;
+
+private:
+    struct alignas(CACHE_LINE) Cell { std::atomic<quint64> v; };
+    Cell m_cells[CELLS];
+};
+
+class Gauge
+{
+public:
+    Gauge() : m_v(0) {}
+    void set(qint64 v) { m_v.store(v, std::memory_order_relaxed); }
+    void add(qint64 d) { m_v.fetch_add(d, std::memory_order_relaxed); }
+    qint64 value() const { return m_v.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<qint64> m_v;
+};
+
+// 지연 histogram (us 로 기록, 초 단위로 출력)
+class Histogram
+{
+public:
+    enum { BOUNDS = 12 };
+    static const quint32 BOUND_US[BOUNDS];     // 0.5 ms ~ 5 s
+
+    Histogram();
+    METRICS_ALIGNED_NEW
+    void observeUs(qint64 us);
+    // cumulative 아님, 마지막은 +Inf
+    void snapshot(quint64* buckets, quint64& count, quint64& sumUs) const;
+
+private:
+    struct alignas(CACHE_LINE) Cell
+    {
+        std::atomic<quint64> buckets[BOUNDS + 1];
+        std::atomic<quint64> count;
+        std::atomic<quint64> sumUs;
+    };
+    Cell m_cells[CELLS];
+};
+
+// 이름 + label 별 metric 보관, 한 번 만든 metric 은 지우지 않는다
+class Registry
+{
+public:
+    static Registry& global();
+
+    // labels 예 : role="master",device="meter1" (중괄호 없이)
+    Counter* counter(const char* name, const char* help, const QByteArray& labels = QByteArray());
+    Gauge* gauge(const char* name, const char* help, const QByteArray& labels = QByteArray());
+    Histogram* histogram(const char* name, const char* help, const QByteArray& labels = QByteArray());
+
+    QByteArray render() const;
+
+private:
+    enum Type { TCounter, TGauge, THistogram };
+    struct Series
+    {
+        QByteArray labels;
+        void* metric;
+    };
+    struct Family
+    {
+        QByteArray name;
+        QByteArray help;
+        Type type;
+        QList<Series> series;
+    };
+
+    Registry() {}
+    ~Registry();
+    void* find(const char* name, const char* help, Type type, const QByteArray& labels);
+
+    mutable QMutex m_lock;          // 등록 / render 만, 값 갱신은 잠그지 않음
+    QList<Family*> m_families;
+
+    Q_DISABLE_COPY(Registry)
+};
+
+} // namespace metrics
+
+#endif // METRICS_H
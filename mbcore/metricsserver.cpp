@@ -0,0 +1,75 @@
+#include "metricsserver.h"
+#include "metrics.h"
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+
+MetricsServer::MetricsServer(QObject *parent) :
+    QObject(parent),
+    m_server(new QTcpServer(this))
+{
+    connect(m_server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+}
+
+bool MetricsServer::listen(quint16 port, QString* err)
+{
+    if (!m_server->listen(QHostAddress::LocalHost, port)) {
+        if (err) *err = QString("metrics listen 127.0.0.1:%1 : %2").arg(port).arg(m_server->errorString());
+        return false;
+    }
+    return true;
+}
+
+void MetricsServer::onNewConnection()
+{
+    while (m_server->hasPendingConnections()) {
+        QTcpSocket* s = m_server->nextPendingConnection();
+        m_requests.insert(s, QByteArray());
+        connect(s, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+        connect(s, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+    }
+}
+
+void MetricsServer::onReadyRead()
+{
+    QTcpSocket* s = qobject_cast<QTcpSocket*>(sender());
+    if (!s || !m_requests.contains(s)) return;
+    QByteArray& req = m_requests[s];
+    req += s->readAll();
+    if (req.size() > MAX_REQUEST) {
+        reply(s, "413 Request Entity Too Large", QByteArray());
+        return;
+    }
+    if (!req.contains("\r\n\r\n") && !req.contains("\n\n")) return;    // header 끝까지
+
+    const QList<QByteArray> first = req.left(req.indexOf('\n')).trimmed().split(' ');
+    if (first.size() < 2 || first[0] != "GET")
+        reply(s, "405 Method Not Allowed", QByteArray());
+    else if (first[1] != "/metrics" && !first[1].startsWith("/metrics?"))
+        reply(s, "404 Not Found", QByteArray());
+    else
+        reply(s, "200 OK", metrics::Registry::global().render());
+}
+
+void MetricsServer::reply(QTcpSocket* s, const char* status, const QByteArray& body)
+{
+    QByteArray out;
+    out.reserve(body.size() + 128);
+    out += "HTTP/1.0 ";
+    out += status;
+    out += "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: ";
+    out += QByteArray::number(body.size());
+    out += "\r\nConnection: close\r\n\r\n";
+    out += body;
+    s->write(out);
+    m_requests.remove(s);
+    s->disconnectFromHost();
+}
+
+void MetricsServer::onDisconnected()
+{
+    QTcpSocket* s = qobject_cast<QTcpSocket*>(sender());
+    if (!s) return;
+    m_requests.remove(s);
+    s->deleteLater();
+}
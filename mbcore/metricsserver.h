@@ -0,0 +1,34 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QByteArray>
+
+class QTcpServer;
+class QTcpSocket;
+
+// localhost 전용 HTTP/1.0 endpoint : GET /metrics 에 metrics::Registry::global() 을 돌려준다
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MetricsServer(QObject *parent = 0);
+
+    bool listen(quint16 port, QString* err);
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+
+private:
+    enum { MAX_REQUEST = 4096 };
+
+    QTcpServer* m_server;
+    QHash<QTcpSocket*, QByteArray> m_requests;
+
+    void reply(QTcpSocket* s, const char* status, const QByteArray& body);
+};
+
+#endif // METRICSSERVER_H
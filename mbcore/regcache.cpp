@@ -0,0 +1,68 @@
+#include "regcache.h"
+#include <cstring>
+
+RegCache::RegCache() :
+    m_hits(0),
+    m_misses(0)
+{
+}
+
+RegCache::~RegCache()
+{
+    clear();
+}
+
+void RegCache::clear()
+{
+    foreach (Bank* b, m_banks) {
+        for (int i = 0; i < PAGES; ++i)
+            delete b->pages[i];
+        delete b;
+    }
+    m_banks.clear();
+}
+
+void RegCache::store(quint8 uid, quint16 start, const quint16* regs, int count, qint64 nowMs)
+{
+    Bank*& b = m_banks[uid];
+    if (!b) {
+        b = new Bank;
+        memset(b->pages, 0, sizeof(b->pages));
+    }
+    for (int i = 0; i < count; ++i) {
+        const int addr = start + i;
+        if (addr > 0xFFFF) break;
+        Page*& p = b->pages[addr >> PAGE_BITS];
+        if (!p) {
+            p = new Page;
+            memset(p, 0, sizeof(Page));
+        }
+        p->value[addr & (PAGE_SIZE - 1)] = regs[i];
+        p->stamp[addr & (PAGE_SIZE - 1)] = nowMs;
+    }
+}
+
+bool RegCache::isFresh(quint8 uid, quint16 start, int count, qint64 nowMs, int maxAgeMs) const
+{
+    const Bank* b = m_banks.value(uid, 0);
+    if (!b) return false;
+    for (int i = 0; i < count; ++i) {
+        const int addr = start + i;
+        if (addr > 0xFFFF) return false;
+        const Page* p = b->pages[addr >> PAGE_BITS];
+        if (!p) return false;
+        const qint64 t = p->stamp[addr & (PAGE_SIZE - 1)];
+        if (t == 0 || nowMs - t > maxAgeMs) return false;
+    }
+    return true;
+}
+
+void RegCache::read(quint8 uid, quint16 start, int count, quint16* out) const
+{
+    const Bank* b = m_banks.value(uid, 0);
+    for (int i = 0; i < count; ++i) {
+        const int addr = start + i;
+        const Page* p = (b && addr <= 0xFFFF) ? b->pages[addr >> PAGE_BITS] : 0;
+        out[i] = p ? p->value[addr & (PAGE_SIZE - 1)] : 0;
+    }
+}
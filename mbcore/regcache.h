@@ -0,0 +1,45 @@
+#ifndef REGCACHE_H
+#define REGCACHE_H
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QHash>
+
+// unit id 별 레지스터 캐시 (값 + 갱신 시각 ms)
+// 64 레지스터 page 단위로 필요할 때만 할당한다.
+class RegCache
+{
+public:
+    RegCache();
+    ~RegCache();
+
+    void store(quint8 uid, quint16 start, const quint16* regs, int count, qint64 nowMs);
+    // [start, start+count) 가 모두 maxAgeMs 이내에 갱신되었는지
+    bool isFresh(quint8 uid, quint16 start, int count, qint64 nowMs, int maxAgeMs) const;
+    // 캐시에 없는 레지스터는 0
+    void read(quint8 uid, quint16 start, int count, quint16* out) const;
+    void clear();
+
+    quint64 hits() const { return m_hits; }
+    quint64 misses() const { return m_misses; }
+    void countHit(bool hit) { if (hit) ++m_hits; else ++m_misses; }
+
+private:
+    enum { PAGE_BITS = 6, PAGE_SIZE = 1 << PAGE_BITS, PAGES = 65536 / PAGE_SIZE };
+    struct Page
+    {
+        quint16 value[PAGE_SIZE];
+        qint64 stamp[PAGE_SIZE];     // 0 = 없음
+    };
+    struct Bank
+    {
+        Page* pages[PAGES];
+    };
+
+    QHash<quint8, Bank*> m_banks;
+    quint64 m_hits;
+    quint64 m_misses;
+
+    Q_DISABLE_COPY(RegCache)
+};
+
+#endif // REGCACHE_H
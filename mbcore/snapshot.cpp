@@ -0,0 +1,140 @@
+#include "snapshot.h"
+#include <cstddef>
+#include <cstring>
+
+namespace {
+
+struct Field
+{
+    const char* name;
+    size_t offset;     // DeviceSnapshot 안 double 위치
+};
+
+#define SNAP_FIELD(name, member) { name, offsetof(DeviceSnapshot, member) }
+
+const Field FIELDS[SnapshotPublisher::FIELD_COUNT] = {
+    SNAP_FIELD("Va", data.vln.i.a),
+    SNAP_FIELD("Vb", data.vln.i.b),
+    SNAP_FIELD("Vc", data.vln.i.c),
+    SNAP_FIELD("Vavg_ln", data.vln.i.avg),
+    SNAP_FIELD("Vab", data.vll.i.a),
+    SNAP_FIELD("Vbc", data.vll.i.b),
+    SNAP_FIELD("Vca", data.vll.i.c),
+    SNAP_FIELD("Vavg_ll", data.vll.i.avg),
+    SNAP_FIELD("Va_fund", data.vfdmt.fdmt.a),
+    SNAP_FIELD("Vb_fund", data.vfdmt.fdmt.b),
+    SNAP_FIELD("Vc_fund", data.vfdmt.fdmt.c),
+    SNAP_FIELD("Vavg_fund", data.vfdmt.fdmt.avg),
+    SNAP_FIELD("Va_thd", data.vthd.THD.a),
+    SNAP_FIELD("Vb_thd", data.vthd.THD.b),
+    SNAP_FIELD("Vc_thd", data.vthd.THD.c),
+    SNAP_FIELD("Vavg_thd", data.vthd.THD.avg),
+    SNAP_FIELD("LN_ub", data.vub.LN_ub),
+    SNAP_FIELD("LL_ub", data.vub.LL_ub),
+    SNAP_FIELD("U0_ub", data.vub.U0_ub),
+    SNAP_FIELD("U2_ub", data.vub.U2_ub),
+    SNAP_FIELD("Va_x", data.vphasor.a_x),
+    SNAP_FIELD("Va_y", data.vphasor.a_y),
+    SNAP_FIELD("Vb_x", data.vphasor.b_x),
+    SNAP_FIELD("Vb_y", data.vphasor.b_y),
+    SNAP_FIELD("Vc_x", data.vphasor.c_x),
+    SNAP_FIELD("Vc_y", data.vphasor.c_y),
+    SNAP_FIELD("Freq", data.Frequency),
+    SNAP_FIELD("Ia_x", iphasor.a_x),
+    SNAP_FIELD("Ia_y", iphasor.a_y),
+    SNAP_FIELD("Ib_x", iphasor.b_x),
+    SNAP_FIELD("Ib_y", iphasor.b_y),
+    SNAP_FIELD("Ic_x", iphasor.c_x),
+    SNAP_FIELD("Ic_y", iphasor.c_y)
+};
+
+#undef SNAP_FIELD
+
+}
+
+int SnapshotPublisher::fieldIndex(const QByteArray& name)
+{
+    for (int i = 0; i < FIELD_COUNT; ++i)
+        if (name == FIELDS[i].name) return i;
+    return -1;
+}
+
+const char* SnapshotPublisher::fieldName(int field)
+{
+    return (field >= 0 && field < FIELD_COUNT) ? FIELDS[field].name : 0;
+}
+
+quint64 SnapshotPublisher::fieldMask(const char* const* names, int n)
+{
+    quint64 mask = 0;
+    for (int i = 0; i < n; ++i) {
+        const int f = fieldIndex(QByteArray(names[i]));
+        if (f >= 0) mask |= quint64(1) << f;
+    }
+    return mask;
+}
+
+SnapshotPublisher::SnapshotPublisher() :
+    m_current(0),
+    m_expected(0),
+    m_cycleQuality(0),
+    m_seq(0),
+    m_dropped(0)
+{
+    memset(&m_work, 0, sizeof(m_work));
+    for (int i = 0; i < SLOTS; ++i) {
+        memset(&m_slots[i].snap, 0, sizeof(DeviceSnapshot));
+        m_slots[i].refs.store(0);
+    }
+}
+
+void SnapshotPublisher::set(int field, double v)
+{
+    if (field < 0 || field >= FIELD_COUNT) return;
+    *reinterpret_cast<double*>(reinterpret_cast<char*>(&m_work) + FIELDS[field].offset) = v;
+    m_work.have |= quint64(1) << field;
+}
+
+bool SnapshotPublisher::publish(qint64 tMs)
+{
+    // 현재 slot 이 아니고 reader 가 없는 slot 에 쓴다.
+    // reader 는 ref 후 m_current 를 다시 확인하므로, 여기서 refs == 0 을 본 slot 을
+    // 나중에 잡은 reader 는 스스로 물러난다.
+    Slot* cur = m_current.load(std::memory_order_relaxed);
+    Slot* dst = 0;
+    for (int i = 0; i < SLOTS && !dst; ++i)
+        if (&m_slots[i] != cur && m_slots[i].refs.load() == 0) dst = &m_slots[i];
+    if (!dst) {
+        ++m_dropped;
+        return false;
+    }
+    m_work.timeMs = tMs;
+    m_work.seq = ++m_seq;
+    m_work.quality = m_cycleQuality;
+    if (!m_work.hasAll(m_expected)) m_work.quality |= DeviceSnapshot::Q_INCOMPLETE;
+    dst->snap = m_work;
+    m_current.store(dst);
+    m_cycleQuality = 0;
+    return true;
+}
+
+const DeviceSnapshot* SnapshotPublisher::acquire() const
+{
+    for (;;) {
+        Slot* s = m_current.load();
+        if (!s) return 0;
+        s->refs.fetch_add(1);
+        if (m_current.load() == s) return &s->snap;
+        s->refs.fetch_sub(1);
+    }
+}
+
+void SnapshotPublisher::release(const DeviceSnapshot* s) const
+{
+    for (int i = 0; i < SLOTS; ++i) {
+        if (&m_slots[i].snap == s) {
+            m_slots[i].refs.fetch_sub(1, std::memory_order_release);
+            return;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QByteArray>
+#include <atomic>
+#include "unit.h"
+
+// 장치 하나의 폴링 주기 결과 (한 주기 안의 값끼리 일관됨)
+struct DeviceSnapshot
+{
+    enum Quality {
+        Q_TIMEOUT = 0x01,      // 주기 중 응답 없는 요청 있음 (해당 값은 이전 주기 값)
+        Q_EXCEPTION = 0x02,    // 주기 중 예외 응답 있음
+        Q_INCOMPLETE = 0x04    // 설정된 필드 중 시작 이후 한 번도 받지 못한 것 있음
+    };
+
+    unit::PT3Data data;
+    unit::VPHASOR iphasor;     // 전류 phasor (PT3Data 에 없음)
+    quint64 have;              // 값이 있는 필드 bit (SnapshotPublisher::fieldIndex)
+    qint64 timeMs;             // 주기 완료 시각
+    quint32 seq;               // 발행 번호, 1 부터
+    quint32 quality;
+
+    bool has(int field) const { return field >= 0 && (have >> field) & 1; }
+    bool hasAll(quint64 mask) const { return (have & mask) == mask; }
+};
+
+// 장치별 snapshot 발행 (RCU 방식 포인터 교체)
+// writer 는 하나 (I/O 쪽), reader 는 여러 스레드에서 acquire/release 로 최신 snapshot 을
+// 복사 없이 읽는다. reader 가 잡고 있는 slot 은 덮어쓰지 않으며 writer 는 기다리지 않는다.
+class SnapshotPublisher
+{
+public:
+    enum {
+        FIELD_COUNT = 33,
+        SLOTS = 4                  // 현재 + 작성 중 + reader 동시 보유분
+    };
+    // 필드 이름 (mbpoll registers= 이름과 같음) -> index, 없으면 -1
+    static int fieldIndex(const QByteArray& name);
+    static const char* fieldName(int field);
+    static quint64 fieldMask(const char* const* names, int n);
+
+    SnapshotPublisher();
+
+    // writer
+    void setExpected(quint64 mask) { m_expected = mask; }    // 장치가 채우는 필드
+    void set(int field, double v);
+    void markQuality(quint32 q) { m_cycleQuality |= q; }
+    bool publish(qint64 tMs);      // slot 이 모두 사용 중이면 false, 값은 다음 주기로 이어짐
+
+    // reader : acquire 한 포인터는 release 전까지 유효. 발행 전이면 0
+    const DeviceSnapshot* acquire() const;
+    void release(const DeviceSnapshot* s) const;
+
+    quint32 published() const { return m_seq; }
+    quint64 dropped() const { return m_dropped; }
+
+private:
+    struct Slot
+    {
+        DeviceSnapshot snap;
+        mutable std::atomic<int> refs;
+    };
+    Slot m_slots[SLOTS];
+    std::atomic<Slot*> m_current;
+    DeviceSnapshot m_work;         // writer 전용 누적 값
+    quint64 m_expected;
+    quint32 m_cycleQuality;
+    quint32 m_seq;
+    quint64 m_dropped;
+
+    Q_DISABLE_COPY(SnapshotPublisher)
+};
+
+// acquire / release 범위 guard
+class SnapshotRef
+{
+public:
+    explicit SnapshotRef(const SnapshotPublisher& p) : m_pub(p), m_snap(p.acquire()) {}
+    ~SnapshotRef() { if (m_snap) m_pub.release(m_snap); }
+
+    const DeviceSnapshot* get() const { return m_snap; }
+    const DeviceSnapshot* operator->() const { return m_snap; }
+    bool isNull() const { return m_snap == 0; }
+
+private:
+    const SnapshotPublisher& m_pub;
+    const DeviceSnapshot* m_snap;
+
+    Q_DISABLE_COPY(SnapshotRef)
+};
+
+#endif // SNAPSHOT_H
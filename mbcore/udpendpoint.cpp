@@ -0,0 +1,291 @@
+#include "udpendpoint.h"
+#include <QSocketNotifier>
+#include <QUdpSocket>
+#include <QHostInfo>
+#include <cstring>
+#include "mbclock.h"
+#if defined(Q_OS_LINUX)
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#endif
+
+#if defined(Q_OS_LINUX)
+namespace {
+
+socklen_t toSockaddr(const QHostAddress& a, quint16 port, sockaddr_storage& ss)
+{
+    memset(&ss, 0, sizeof(ss));
+    if (a.protocol() == QAbstractSocket::IPv6Protocol) {
+        sockaddr_in6* s6 = reinterpret_cast<sockaddr_in6*>(&ss);
+        s6->sin6_family = AF_INET6;
+        s6->sin6_port = htons(port);
+        const Q_IPV6ADDR ip = a.toIPv6Address();
+        memcpy(&s6->sin6_addr, &ip, sizeof(s6->sin6_addr));
+        return sizeof(*s6);
+    }
+    // Any 는 0.0.0.0
+    sockaddr_in* s4 = reinterpret_cast<sockaddr_in*>(&ss);
+    s4->sin_family = AF_INET;
+    s4->sin_port = htons(port);
+    s4->sin_addr.s_addr = htonl(a.toIPv4Address());
+    return sizeof(*s4);
+}
+
+quint16 portOf(const sockaddr_storage& ss)
+{
+    if (ss.ss_family == AF_INET6) return ntohs(reinterpret_cast<const sockaddr_in6*>(&ss)->sin6_port);
+    return ntohs(reinterpret_cast<const sockaddr_in*>(&ss)->sin_port);
+}
+
+QString sysError()
+{
+    return QString::fromLocal8Bit(strerror(errno));
+}
+
+}
+#endif
+
+UdpEndpoint::UdpEndpoint(QObject *parent) :
+    QObject(parent),
+    m_fd(-1),
+    m_notifier(0),
+    m_qsock(0),
+    m_localPort(0),
+    m_kernelStamps(false),
+    m_txCount(0),
+    m_recvCalls(0),
+    m_datagrams(0),
+    m_dropped(0)
+{
+    m_peer.port = 0;
+    m_rxBuf.resize(BATCH * RX_CAP);
+    m_txBuf.resize(BATCH * RX_CAP);
+    m_txLen.resize(BATCH);
+    m_txTo.resize(BATCH);
+}
+
+UdpEndpoint::~UdpEndpoint()
+{
+    close();
+}
+
+bool UdpEndpoint::isOpen() const
+{
+    return m_fd >= 0 || m_qsock;
+}
+
+void UdpEndpoint::close()
+{
+    m_txCount = 0;
+    // datagram() 처리 중에 불릴 수 있으므로 notifier 는 나중에 지운다
+    if (m_notifier) {
+        m_notifier->setEnabled(false);
+        m_notifier->deleteLater();
+        m_notifier = 0;
+    }
+#if defined(Q_OS_LINUX)
+    if (m_fd >= 0) ::close(m_fd);
+#endif
+    m_fd = -1;
+    if (m_qsock) {
+        m_qsock->disconnect(this);
+        m_qsock->deleteLater();
+        m_qsock = 0;
+    }
+    m_localPort = 0;
+    m_peer.port = 0;
+}
+
+bool UdpEndpoint::bind(const QHostAddress& addr, quint16 port, QString* err)
+{
+    return open(addr, port, true, err);
+}
+
+bool UdpEndpoint::connectTo(const QString& host, quint16 port, QString* err)
+{
+    QHostAddress addr;
+    if (!addr.setAddress(host)) {
+        const QHostInfo info = QHostInfo::fromName(host);
+        if (info.addresses().isEmpty()) {
+            if (err) *err = QString("%1 : %2").arg(host, info.errorString());
+            return false;
+        }
+        addr = info.addresses().first();
+    }
+    return open(addr, port, false, err);
+}
+
+bool UdpEndpoint::open(const QHostAddress& addr, quint16 port, bool doBind, QString* err)
+{
+    close();
+#if defined(Q_OS_LINUX)
+    sockaddr_storage ss;
+    const socklen_t len = toSockaddr(addr, port, ss);
+    m_fd = ::socket(ss.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        if (err) *err = QString("udp socket : %1").arg(sysError());
+        return false;
+    }
+    int on = 1;
+    m_kernelStamps = setsockopt(m_fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0;
+    if (doBind) setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    const int rc = doBind ? ::bind(m_fd, reinterpret_cast<sockaddr*>(&ss), len)
+                          : ::connect(m_fd, reinterpret_cast<sockaddr*>(&ss), len);
+    if (rc < 0) {
+        if (err) *err = QString("udp %1 %2:%3 : %4").arg(doBind ? "bind" : "connect")
+                                                     .arg(addr.toString()).arg(port).arg(sysError());
+        close();
+        return false;
+    }
+    sockaddr_storage local;
+    socklen_t localLen = sizeof(local);
+    if (getsockname(m_fd, reinterpret_cast<sockaddr*>(&local), &localLen) == 0)
+        m_localPort = portOf(local);
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, SIGNAL(activated(int)), this, SLOT(onReadable()));
+#else
+    m_qsock = new QUdpSocket(this);
+    const QHostAddress local = doBind ? addr
+        : (addr.protocol() == QAbstractSocket::IPv6Protocol ? QHostAddress(QHostAddress::AnyIPv6) : QHostAddress(QHostAddress::Any));
+    if (!m_qsock->bind(local, doBind ? port : 0)) {
+        if (err) *err = QString("udp bind : %1").arg(m_qsock->errorString());
+        close();
+        return false;
+    }
+    if (!doBind) {
+        m_peer.addr = addr;
+        m_peer.port = port;
+    }
+    m_localPort = m_qsock->localPort();
+    connect(m_qsock, SIGNAL(readyRead()), this, SLOT(onReadable()));
+#endif
+    return true;
+}
+
+void UdpEndpoint::queue(const uchar* p, int n, const UdpPeer* to)
+{
+    if (!isOpen() || n <= 0 || n > RX_CAP) {
+        ++m_dropped;
+        return;
+    }
+    memcpy(m_txBuf.data() + m_txCount * RX_CAP, p, n);
+    m_txLen[m_txCount] = n;
+    if (to) {
+        m_txTo[m_txCount] = *to;
+    } else {
+        m_txTo[m_txCount].port = 0;
+    }
+    if (++m_txCount == BATCH) flush();
+}
+
+void UdpEndpoint::flush()
+{
+    if (m_txCount == 0) return;
+    const int count = m_txCount;
+    m_txCount = 0;
+    int sent = 0;
+#if defined(Q_OS_LINUX)
+    if (m_fd < 0) return;
+    mmsghdr msgs[BATCH];
+    iovec iov[BATCH];
+    sockaddr_storage to[BATCH];
+    memset(msgs, 0, sizeof(msgs[0]) * count);
+    for (int i = 0; i < count; ++i) {
+        iov[i].iov_base = m_txBuf.data() + i * RX_CAP;
+        iov[i].iov_len = m_txLen[i];
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        if (m_txTo[i].port) {
+            msgs[i].msg_hdr.msg_name = &to[i];
+            msgs[i].msg_hdr.msg_namelen = toSockaddr(m_txTo[i].addr, m_txTo[i].port, to[i]);
+        }
+    }
+    while (sent < count) {
+        const int r = sendmmsg(m_fd, msgs + sent, count - sent, 0);
+        if (r > 0) sent += r;
+        else if (errno != EINTR) break;     // EAGAIN 등 : 남은 것은 버림 (재전송은 master 몫)
+    }
+#else
+    for (int i = 0; i < count; ++i) {
+        const UdpPeer& to = m_txTo[i].port ? m_txTo[i] : m_peer;
+        if (m_qsock->writeDatagram(m_txBuf.constData() + i * RX_CAP, m_txLen[i], to.addr, to.port) == m_txLen[i])
+            ++sent;
+    }
+#endif
+    m_dropped += count - sent;
+}
+
+void UdpEndpoint::onReadable()
+{
+#if defined(Q_OS_LINUX)
+    mmsghdr msgs[BATCH];
+    iovec iov[BATCH];
+    sockaddr_storage from[BATCH];
+    union { cmsghdr align; char buf[CMSG_SPACE(sizeof(timespec))]; } ctrl[BATCH];
+    uchar* rx = reinterpret_cast<uchar*>(m_rxBuf.data());
+    for (;;) {
+        memset(msgs, 0, sizeof(msgs));
+        for (int i = 0; i < BATCH; ++i) {
+            iov[i].iov_base = rx + i * RX_CAP;
+            iov[i].iov_len = RX_CAP;
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &from[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+            msgs[i].msg_hdr.msg_control = ctrl[i].buf;
+            msgs[i].msg_hdr.msg_controllen = sizeof(ctrl[i].buf);
+        }
+        const int n = recvmmsg(m_fd, msgs, BATCH, MSG_DONTWAIT, 0);
+        if (n <= 0) break;
+        ++m_recvCalls;
+        // 커널 시각 (CLOCK_REALTIME) 은 지금과의 차이만큼 monoNs 에서 뺀다
+        const qint64 monoNow = mb::monoNs();
+        timespec real;
+        clock_gettime(CLOCK_REALTIME, &real);
+        const qint64 realNow = qint64(real.tv_sec) * 1000000000 + real.tv_nsec;
+        for (int i = 0; i < n; ++i) {
+            msghdr& h = msgs[i].msg_hdr;
+            if (h.msg_flags & MSG_TRUNC) {
+                ++m_dropped;
+                continue;
+            }
+            qint64 rxNs = monoNow;
+            for (cmsghdr* c = CMSG_FIRSTHDR(&h); c; c = CMSG_NXTHDR(&h, c)) {
+                if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_TIMESTAMPNS) continue;
+                timespec ts;
+                memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                const qint64 age = realNow - (qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec);
+                if (age >= 0 && age < 1000000000) rxNs = monoNow - age;
+            }
+            UdpPeer peer;
+            peer.addr = QHostAddress(reinterpret_cast<const sockaddr*>(&from[i]));
+            peer.port = portOf(from[i]);
+            ++m_datagrams;
+            emit datagram(rx + i * RX_CAP, int(msgs[i].msg_len), peer, rxNs);
+            if (m_fd < 0) return;           // 처리 중 close
+        }
+        flush();
+        if (n < BATCH) break;
+    }
+#else
+    uchar* rx = reinterpret_cast<uchar*>(m_rxBuf.data());
+    while (m_qsock && m_qsock->hasPendingDatagrams()) {
+        const bool tooBig = m_qsock->pendingDatagramSize() > RX_CAP;
+        UdpPeer peer;
+        const qint64 n = m_qsock->readDatagram(reinterpret_cast<char*>(rx), RX_CAP, &peer.addr, &peer.port);
+        const qint64 rxNs = mb::monoNs();
+        ++m_recvCalls;
+        if (n <= 0 || tooBig) {
+            ++m_dropped;
+            continue;
+        }
+        if (m_peer.port && (peer.port != m_peer.port || peer.addr != m_peer.addr)) continue;
+        ++m_datagrams;
+        emit datagram(rx, int(n), peer, rxNs);
+    }
+    flush();
+#endif
+}
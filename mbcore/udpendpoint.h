@@ -0,0 +1,74 @@
+#ifndef UDPENDPOINT_H
+#define UDPENDPOINT_H
+
+#include <QObject>
+#include <QHostAddress>
+#include <QByteArray>
+#include <QVector>
+
+class QSocketNotifier;
+class QUdpSocket;
+
+struct UdpPeer
+{
+    QHostAddress addr;
+    quint16 port;           // 0 = connectTo 한 상대
+};
+
+// Modbus/UDP 송수신 (datagram 하나 = ADU 하나)
+// Linux 는 recvmmsg 로 한 번에 BATCH 개까지 읽고, SO_TIMESTAMPNS 커널 수신 시각을 mb::monoNs() 기준으로 바꿔 준다.
+// datagram() 처리 중 queue() 한 응답은 그 batch 가 끝날 때 sendmmsg 한 번으로 나간다.
+// 다른 OS 는 QUdpSocket 으로 하나씩 읽고 보낸다.
+class UdpEndpoint : public QObject
+{
+    Q_OBJECT
+public:
+    enum { BATCH = 32 };
+
+    explicit UdpEndpoint(QObject *parent = 0);
+    ~UdpEndpoint();
+
+    bool bind(const QHostAddress& addr, quint16 port, QString* err);     // listener
+    bool connectTo(const QString& host, quint16 port, QString* err);     // client, 상대 고정
+    void close();
+    bool isOpen() const;
+    quint16 localPort() const { return m_localPort; }
+
+    // to 가 0 이면 connectTo 한 상대. 가득 차면 바로 flush
+    void queue(const uchar* p, int n, const UdpPeer* to = 0);
+    void flush();
+
+    quint64 recvCalls() const { return m_recvCalls; }
+    quint64 datagrams() const { return m_datagrams; }
+    quint64 dropped() const { return m_dropped; }       // 너무 큰 수신 / 보내기 실패
+    bool kernelStamps() const { return m_kernelStamps; }
+
+signals:
+    // p 는 signal 처리 중에만 유효 (direct connection 으로만 받을 것)
+    void datagram(const uchar* p, int n, const UdpPeer& from, qint64 rxNs);
+
+private slots:
+    void onReadable();
+
+private:
+    enum { RX_CAP = 512 };      // 이보다 큰 datagram 은 버린다 (MAX_ADU 초과는 parseFrame 이 거름)
+
+    int m_fd;
+    QSocketNotifier* m_notifier;
+    QUdpSocket* m_qsock;        // Linux 외
+    quint16 m_localPort;
+    UdpPeer m_peer;             // connectTo 상대
+    bool m_kernelStamps;
+    QByteArray m_rxBuf;         // BATCH * RX_CAP
+    QByteArray m_txBuf;         // BATCH * RX_CAP
+    QVector<int> m_txLen;
+    QVector<UdpPeer> m_txTo;
+    int m_txCount;
+    quint64 m_recvCalls;
+    quint64 m_datagrams;
+    quint64 m_dropped;
+
+    bool open(const QHostAddress& addr, quint16 port, bool doBind, QString* err);
+};
+
+#endif // UDPENDPOINT_H
@@ -0,0 +1,365 @@
+#include "gateway.h"
+#include <QHostAddress>
+#include <QtAlgorithms>
+#include <QtDebug>
+#include <cstring>
+
+Gateway::Gateway(QObject *parent) :
+    QObject(parent),
+    m_server(new QTcpServer(this)),
+    m_down(new MbPoller(this)),
+    m_sweepTimer(new QTimer(this)),
+    m_statsTimer(new QTimer(this)),
+    m_flushQueued(false),
+    m_freshMs(1000),
+    m_timeoutMs(1000),
+    m_mergeGap(8),
+    m_upRequests(0),
+    m_downRequests(0)
+{
+    m_clock.start();
+    connect(m_server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+    connect(m_down, SIGNAL(replyReady(MbReply)), this, SLOT(onDownReply(MbReply)));
+    connect(m_down, SIGNAL(requestTimedOut(int,quint16)), this, SLOT(onDownTimedOut(int,quint16)));
+    connect(m_down, SIGNAL(disconnected()), this, SLOT(onDownDisconnected()));
+    connect(m_sweepTimer, SIGNAL(timeout()), this, SLOT(onSweep()));
+    connect(m_statsTimer, SIGNAL(timeout()), this, SLOT(printStats()));
+    m_sweepTimer->start(100);
+    m_statsTimer->start(60000);
+}
+
+Gateway::~Gateway()
+{
+    qDeleteAll(m_readers);
+}
+
+bool Gateway::listen(const QHostAddress& addr, quint16 port, QString* err)
+{
+    if (!m_server->listen(addr, port)) {
+        if (err) *err = QString("listen fail : %1").arg(m_server->errorString());
+        return false;
+    }
+    return true;
+}
+
+void Gateway::connectDownstream(const QString& host, quint16 port)
+{
+    m_down->start(host, port, 0);
+}
+
+void Gateway::onNewConnection()
+{
+    while (m_server->hasPendingConnections()) {
+        QTcpSocket* s = m_server->nextPendingConnection();
+        m_readers.insert(s, new mb::FrameReader);
+        connect(s, SIGNAL(readyRead()), this, SLOT(onClientReadyRead()));
+        connect(s, SIGNAL(disconnected()), this, SLOT(onClientDisconnected()));
+    }
+}
+
+void Gateway::onClientDisconnected()
+{
+    QTcpSocket* s = qobject_cast<QTcpSocket*>(sender());
+    if (!s) return;
+    delete m_readers.take(s);
+    s->deleteLater();
+}
+
+void Gateway::onClientReadyRead()
+{
+    QTcpSocket* s = qobject_cast<QTcpSocket*>(sender());
+    mb::FrameReader* reader = m_readers.value(s, 0);
+    if (!reader) return;
+    reader->append(s->readAll());
+    mb::Frame f;
+    while (reader->next(f))
+        handleRequest(s, f);
+}
+
+void Gateway::sendTo(QTcpSocket* s, const uchar* p, int n)
+{
+    if (!s || n <= 0) return;
+    s->write(reinterpret_cast<const char*>(p), n);
+}
+
+void Gateway::handleRequest(QTcpSocket* s, const mb::Frame& f)
+{
+    if (f.isException()) return;
+    ++m_upRequests;
+    uchar out[mb::MAX_ADU];
+    Waiter w;
+    w.client = s;
+    w.tid = f.mb.tid;
+    w.uid = f.mb.uid;
+    w.fc = f.fc;
+    w.sinceMs = now();
+
+    quint16 start = 0, count = 0;
+    mb::BlockView blocks;
+    if (mb::decodeReadRequest(f, start, count)) {
+        if (count == 0 || count > mb::MAX_READ_REGS) {
+            sendTo(s, out, mb::encodeException(out, sizeof(out), f.mb.tid, f.mb.uid, f.fc, mb::EX_ILLEGAL_VALUE));
+            return;
+        }
+        w.nBlocks = 1;
+        mb::wr16be(w.desc, start);
+        mb::wr16be(w.desc + 2, count);
+    } else if (mb::decodeMultiReadRequest(f, blocks) && blocks.count <= MAX_BLOCKS) {
+        int total = 0;
+        for (int b = 0; b < blocks.count; ++b)
+            total += blocks.regs(b);
+        if (total > mb::MAX_READ_REGS) {
+            sendTo(s, out, mb::encodeException(out, sizeof(out), f.mb.tid, f.mb.uid, f.fc, mb::EX_ILLEGAL_VALUE));
+            return;
+        }
+        w.nBlocks = blocks.count;
+        memcpy(w.desc, blocks.p, 4 * blocks.count);
+    } else {
+        const quint8 code = (f.fc == mb::FC_READ_HOLDING || f.fc == mb::FC_MULTI_READ) ? mb::EX_ILLEGAL_VALUE : mb::EX_ILLEGAL_FUNCTION;
+        sendTo(s, out, mb::encodeException(out, sizeof(out), f.mb.tid, f.mb.uid, f.fc, code));
+        return;
+    }
+
+    const qint64 t = now();
+    const bool fresh = isFresh(w, t);
+    m_cache.countHit(fresh);
+    if (fresh) {
+        answer(w);
+        return;
+    }
+    for (int b = 0; b < w.nBlocks; ++b) {
+        Range r;
+        r.uid = w.uid;
+        r.start = mb::rd16be(w.desc + 4 * b);
+        r.count = mb::rd16be(w.desc + 4 * b + 2);
+        if (r.count > 0 && !m_cache.isFresh(r.uid, r.start, r.count, t, m_freshMs))
+            want(r);
+    }
+    m_waiters.append(w);
+}
+
+bool Gateway::isFresh(const Waiter& w, qint64 t) const
+{
+    // 요청이 도착한 뒤 읽은 값이면 freshMs 와 무관하게 응답한다
+    const int maxAge = int(qMax<qint64>(m_freshMs, t - w.sinceMs));
+    for (int b = 0; b < w.nBlocks; ++b) {
+        const quint16 start = mb::rd16be(w.desc + 4 * b);
+        const quint16 count = mb::rd16be(w.desc + 4 * b + 2);
+        if (count > 0 && !m_cache.isFresh(w.uid, start, count, t, maxAge))
+            return false;
+    }
+    return true;
+}
+
+bool Gateway::coveredByFetch(const Range& r) const
+{
+    foreach (const Fetch& f, m_fetches) {
+        if (f.range.uid == r.uid && f.range.start <= r.start
+                && int(f.range.start) + f.range.count >= int(r.start) + r.count)
+            return true;
+    }
+    return false;
+}
+
+void Gateway::want(const Range& r)
+{
+    if (coveredByFetch(r)) return;
+    m_wanted.append(r);
+    // 같은 event loop 회차에 들어온 요청을 모아 병합한다
+    if (!m_flushQueued) {
+        m_flushQueued = true;
+        QTimer::singleShot(0, this, SLOT(flushFetches()));
+    }
+}
+
+bool Gateway::rangeLess(const Range& a, const Range& b)
+{
+    if (a.uid != b.uid) return a.uid < b.uid;
+    return a.start < b.start;
+}
+
+void Gateway::flushFetches()
+{
+    m_flushQueued = false;
+    if (m_wanted.isEmpty()) return;
+    qSort(m_wanted.begin(), m_wanted.end(), rangeLess);
+
+    // 겹치거나 mergeGap 이내로 붙은 구간을 125 레지스터 한도까지 합친다
+    // parts 는 gap 없이 합친 구간 (합친 읽기가 예외면 이것만 다시 읽는다)
+    QVector<Range> merged;
+    QVector<QVector<Range> > parts;
+    merged.reserve(m_wanted.size());
+    foreach (const Range& r, m_wanted) {
+        if (!merged.isEmpty()) {
+            Range& m = merged.last();
+            const int mEnd = int(m.start) + m.count;
+            const int rEnd = int(r.start) + r.count;
+            if (m.uid == r.uid && int(r.start) <= mEnd + m_mergeGap
+                    && qMax(mEnd, rEnd) - int(m.start) <= mb::MAX_READ_REGS) {
+                m.count = quint16(qMax(mEnd, rEnd) - m.start);
+                Range& last = parts.last().last();
+                const int lastEnd = int(last.start) + last.count;
+                if (int(r.start) <= lastEnd) last.count = quint16(qMax(lastEnd, rEnd) - last.start);
+                else parts.last().append(r);
+                continue;
+            }
+        }
+        merged.append(r);
+        parts.append(QVector<Range>() << r);
+    }
+    m_wanted.clear();
+
+    for (int i = 0; i < merged.size(); ++i) {
+        if (coveredByFetch(merged[i])) continue;
+        fetch(merged[i], parts[i]);
+    }
+}
+
+void Gateway::fetch(const Range& r, const QVector<Range>& parts)
+{
+    if (!m_down->sendRead(r.uid, r.start, r.count)) {
+        failOverlapping(r, mb::EX_GATEWAY_PATH);
+        return;
+    }
+    ++m_downRequests;
+    Fetch f;
+    f.range = r;
+    f.parts = parts;
+    f.tid = m_down->lastTid();
+    m_fetches.append(f);
+}
+
+void Gateway::onDownReply(const MbReply& r)
+{
+    if (r.item != -1) return;
+    for (int i = 0; i < m_fetches.size(); ++i) {
+        if (m_fetches[i].tid != r.frame.mb.tid) continue;
+        const Fetch f = m_fetches.takeAt(i);
+        if (r.frame.isException() && f.parts.size() > 1) {
+            // gap 레지스터가 예외의 원인일 수 있으므로 요청된 구간만 따로 다시 읽는다
+            foreach (const Range& part, f.parts) {
+                if (!coveredByFetch(part)) fetch(part, QVector<Range>() << part);
+            }
+            return;
+        }
+        if (r.frame.isException() || r.regs.count != f.range.count) {
+            failOverlapping(f.range, r.frame.isException() ? r.frame.exceptionCode() : quint8(mb::EX_GATEWAY_TARGET));
+            return;
+        }
+        quint16 regs[mb::MAX_READ_REGS];
+        for (int k = 0; k < r.regs.count; ++k)
+            regs[k] = r.regs.at(k);
+        m_cache.store(f.range.uid, f.range.start, regs, r.regs.count, now());
+        serviceWaiters();
+        return;
+    }
+}
+
+void Gateway::onDownTimedOut(int item, quint16 tid)
+{
+    if (item != -1) return;
+    for (int i = 0; i < m_fetches.size(); ++i) {
+        if (m_fetches[i].tid != tid) continue;
+        const Fetch f = m_fetches.takeAt(i);
+        failOverlapping(f.range, mb::EX_GATEWAY_TARGET);
+        return;
+    }
+}
+
+// 끊기면 poller 가 진행 중 요청을 버리므로 (응답도 timeout 도 오지 않음) 여기서 정리한다
+void Gateway::onDownDisconnected()
+{
+    const QList<Fetch> fetches = m_fetches;
+    m_fetches.clear();
+    foreach (const Fetch& f, fetches)
+        failOverlapping(f.range, mb::EX_GATEWAY_TARGET);
+}
+
+void Gateway::serviceWaiters()
+{
+    const qint64 t = now();
+    for (int i = 0; i < m_waiters.size(); ) {
+        if (isFresh(m_waiters[i], t)) {
+            answer(m_waiters[i]);
+            m_waiters.removeAt(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+void Gateway::failOverlapping(const Range& r, quint8 code)
+{
+    const qint64 t = now();
+    for (int i = 0; i < m_waiters.size(); ) {
+        const Waiter& w = m_waiters[i];
+        bool hit = false;
+        for (int b = 0; b < w.nBlocks && !hit; ++b) {
+            const int start = mb::rd16be(w.desc + 4 * b);
+            const int count = mb::rd16be(w.desc + 4 * b + 2);
+            hit = (w.uid == r.uid && start < int(r.start) + r.count && int(r.start) < start + count);
+        }
+        if (hit && !isFresh(w, t)) {
+            fail(w, code);
+            m_waiters.removeAt(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+void Gateway::answer(const Waiter& w)
+{
+    if (!w.client) return;
+    quint16 regs[mb::MAX_READ_REGS];
+    int nRegs = 0;
+    for (int b = 0; b < w.nBlocks; ++b) {
+        const quint16 start = mb::rd16be(w.desc + 4 * b);
+        const quint16 count = mb::rd16be(w.desc + 4 * b + 2);
+        m_cache.read(w.uid, start, count, regs + nRegs);
+        nRegs += count;
+    }
+    uchar out[mb::MAX_ADU];
+    int n;
+    if (w.fc == mb::FC_READ_HOLDING) {
+        n = mb::encodeReadReply(out, sizeof(out), w.tid, w.uid, regs, nRegs);
+    } else {
+        const mb::BlockView blocks = { w.desc, w.nBlocks };
+        n = mb::encodeMultiReadReply(out, sizeof(out), w.tid, w.uid, blocks, regs, nRegs);
+    }
+    if (n == 0)
+        n = mb::encodeException(out, sizeof(out), w.tid, w.uid, w.fc, mb::EX_ILLEGAL_VALUE);
+    sendTo(w.client, out, n);
+}
+
+void Gateway::fail(const Waiter& w, quint8 code)
+{
+    if (!w.client) return;
+    uchar out[mb::MAX_ADU];
+    sendTo(w.client, out, mb::encodeException(out, sizeof(out), w.tid, w.uid, w.fc, code));
+}
+
+void Gateway::onSweep()
+{
+    // downstream 이 끊긴 동안 쌓인 요청 정리
+    const qint64 t = now();
+    for (int i = 0; i < m_waiters.size(); ) {
+        const Waiter& w = m_waiters[i];
+        if (!w.client) {
+            m_waiters.removeAt(i);
+        } else if (t - w.sinceMs > 2 * m_timeoutMs) {
+            fail(w, mb::EX_GATEWAY_TARGET);
+            m_waiters.removeAt(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+void Gateway::printStats()
+{
+    qWarning("upstream clients=%d requests=%llu cache hit=%llu miss=%llu downstream requests=%llu",
+             m_readers.size(), (unsigned long long)m_upRequests,
+             (unsigned long long)m_cache.hits(), (unsigned long long)m_cache.misses(),
+             (unsigned long long)m_downRequests);
+}
@@ -0,0 +1,102 @@
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QPointer>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "mbpoller.h"
+#include "regcache.h"
+
+// 캐싱 Modbus TCP gateway
+// 여러 upstream (SCADA/HMI) 요청을 RegCache 로 응답하고,
+// 캐시가 오래된 구간만 모아 병합한 뒤 downstream 미터에 한 번 읽는다.
+class Gateway : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Gateway(QObject *parent = 0);
+    ~Gateway();
+
+    void setFreshMs(int ms) { m_freshMs = ms; }
+    void setTimeoutMs(int ms) { m_timeoutMs = ms; m_down->setTimeout(ms); }
+    void setMergeGap(int regs) { m_mergeGap = regs; }
+
+    bool listen(const QHostAddress& addr, quint16 port, QString* err);
+    void connectDownstream(const QString& host, quint16 port);
+
+private slots:
+    void onNewConnection();
+    void onClientReadyRead();
+    void onClientDisconnected();
+    void onDownReply(const MbReply& r);
+    void onDownTimedOut(int item, quint16 tid);
+    void onDownDisconnected();
+    void flushFetches();
+    void onSweep();
+    void printStats();
+
+private:
+    enum { MAX_BLOCKS = 62 };      // 0x65 요청 PDU 253 byte 안의 블록 수
+
+    struct Range
+    {
+        quint8 uid;
+        quint16 start;
+        quint16 count;
+    };
+    // 캐시 갱신을 기다리는 upstream 요청
+    struct Waiter
+    {
+        QPointer<QTcpSocket> client;
+        quint16 tid;
+        quint8 uid;
+        quint8 fc;
+        int nBlocks;
+        uchar desc[4 * MAX_BLOCKS];   // (start, count) big endian, 0x65 응답에 그대로 echo
+        qint64 sinceMs;
+    };
+    struct Fetch
+    {
+        Range range;
+        QVector<Range> parts;     // 요청된 (겹치거나 붙은 것만 합친) 구간. 2 개 이상이면 gap 을 끼워 읽은 것
+        quint16 tid;
+    };
+
+    QTcpServer* m_server;
+    MbPoller* m_down;
+    QTimer* m_sweepTimer;
+    QTimer* m_statsTimer;
+    QElapsedTimer m_clock;
+    RegCache m_cache;
+    QHash<QTcpSocket*, mb::FrameReader*> m_readers;
+    QList<Waiter> m_waiters;
+    QList<Fetch> m_fetches;           // downstream 진행 중
+    QVector<Range> m_wanted;          // 다음 flush 에 읽을 구간
+    bool m_flushQueued;
+    int m_freshMs;
+    int m_timeoutMs;
+    int m_mergeGap;
+    quint64 m_upRequests;
+    quint64 m_downRequests;
+
+    qint64 now() const { return m_clock.elapsed() + 1; }
+    void handleRequest(QTcpSocket* s, const mb::Frame& f);
+    bool isFresh(const Waiter& w, qint64 t) const;
+    bool coveredByFetch(const Range& r) const;
+    void want(const Range& r);
+    void fetch(const Range& r, const QVector<Range>& parts);
+    void answer(const Waiter& w);
+    void fail(const Waiter& w, quint8 code);
+    void serviceWaiters();
+    void failOverlapping(const Range& r, quint8 code);
+    static void sendTo(QTcpSocket* s, const uchar* p, int n);
+    static bool rangeLess(const Range& a, const Range& b);
+};
+
+#endif // GATEWAY_H
@@ -0,0 +1,64 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <QHostAddress>
+#include <cstdio>
+#include "gateway.h"
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr, "usage: %s -t meter_ip[:port] [-l listen_ip[:port]] [-f fresh_ms] [-w timeout_ms] [-g merge_gap]\n", argv0);
+}
+
+static bool splitHostPort(const QString& text, QString& host, quint16& port)
+{
+    const int colon = text.lastIndexOf(':');
+    host = (colon < 0) ? text : text.left(colon);
+    if (colon < 0) return !host.isEmpty();
+    bool ok = false;
+    const int p = text.mid(colon + 1).toInt(&ok);
+    if (!ok || p < 1 || p > 65535) return false;
+    port = quint16(p);
+    return !host.isEmpty();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QString target, listen("0.0.0.0:502");
+    int freshMs = 1000, timeoutMs = 1000, mergeGap = 8;
+    const QStringList args = a.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        const QString& opt = args[i];
+        if (i + 1 >= args.size()) { usage(argv[0]); return 1; }
+        if (opt == "-t") target = args[++i];
+        else if (opt == "-l") listen = args[++i];
+        else if (opt == "-f") freshMs = args[++i].toInt();
+        else if (opt == "-w") timeoutMs = args[++i].toInt();
+        else if (opt == "-g") mergeGap = args[++i].toInt();
+        else { usage(argv[0]); return 1; }
+    }
+    QString downHost, upHost;
+    quint16 downPort = 502, upPort = 502;
+    if (!splitHostPort(target, downHost, downPort) || !splitHostPort(listen, upHost, upPort)
+            || freshMs < 0 || timeoutMs <= 0 || mergeGap < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    QHostAddress bindAddr;
+    if (upHost == "0.0.0.0") bindAddr = QHostAddress::Any;
+    else if (!bindAddr.setAddress(upHost)) { usage(argv[0]); return 1; }
+
+    Gateway gw;
+    gw.setFreshMs(freshMs);
+    gw.setTimeoutMs(timeoutMs);
+    gw.setMergeGap(mergeGap);
+    QString err;
+    if (!gw.listen(bindAddr, upPort, &err)) {
+        fprintf(stderr, "%s\n", qPrintable(err));
+        return 1;
+    }
+    gw.connectDownstream(downHost, downPort);
+
+    return a.exec();
+}
@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# 캐싱 Modbus TCP gateway (여러 SCADA -> 미터 1대)
+#
+#-------------------------------------------------
+
+QT       += core network
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+QMAKE_CXXFLAGS += -std=gnu++11
+
+include(../mbcore/mbcore.pri)
+
+TARGET = mbgate
+TEMPLATE = app
+
+
+SOURCES += main.cpp\
+        gateway.cpp
+
+HEADERS  += gateway.h
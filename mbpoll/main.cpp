@@ -0,0 +1,41 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <cstdio>
+#include "pollapp.h"
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr, "usage: %s -c config.ini [-f csv|line|bin] [-o file|-]\n", argv0);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QString config, format, output;
+    const QStringList args = a.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        const QString& opt = args[i];
+        if (i + 1 >= args.size()) { usage(argv[0]); return 1; }
+        if (opt == "-c") config = args[++i];
+        else if (opt == "-f") format = args[++i];
+        else if (opt == "-o") output = args[++i];
+        else { usage(argv[0]); return 1; }
+    }
+    if (config.isEmpty()) { usage(argv[0]); return 1; }
+
+    PollApp app;
+    QString err;
+    if (!app.load(config, &err)) {
+        fprintf(stderr, "%s\n", qPrintable(err));
+        return 1;
+    }
+    if (!app.openOutput(output.isEmpty() ? app.outputPath() : output,
+                        format.isEmpty() ? app.outputFormat() : format, &err)) {
+        fprintf(stderr, "%s\n", qPrintable(err));
+        return 1;
+    }
+    app.start();
+
+    return a.exec();
+}
@@ -0,0 +1,28 @@
+#-------------------------------------------------
+#
+# headless master (X 없는 게이트웨이용 폴링 데몬)
+#
+#-------------------------------------------------
+
+QT       += core network
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+QMAKE_CXXFLAGS += -std=gnu++11
+
+include(../mbcore/mbcore.pri)
+
+TARGET = mbpoll
+TEMPLATE = app
+
+
+SOURCES += main.cpp\
+        pollapp.cpp\
+        samplewriter.cpp
+
+HEADERS  += pollapp.h\
+        samplewriter.h
+
+OTHER_FILES += mbpoll.ini
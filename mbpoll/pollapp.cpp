@@ -0,0 +1,276 @@
+#include "pollapp.h"
+#include <QSettings>
+#include <QStringList>
+#include <QTimer>
+#include <QtDebug>
+#include <cstring>
+
+// 파생 값 계산에 쓰는 snapshot 필드 (registers= 에서 이 이름으로 지정)
+static const char* const VPHASOR_NAMES[] = { "Va_x", "Va_y", "Vb_x", "Vb_y", "Vc_x", "Vc_y" };
+static const char* const IPHASOR_NAMES[] = { "Ia_x", "Ia_y", "Ib_x", "Ib_y", "Ic_x", "Ic_y" };
+
+PollApp::PollApp(QObject *parent) :
+    QObject(parent),
+    m_derivedTimer(new QTimer(this)),
+    m_outPath("-"),
+    m_outFormat("csv")
+{
+    m_derivedTimer->setInterval(DERIVED_MS);
+    connect(m_derivedTimer, SIGNAL(timeout()), this, SLOT(onDerivedTick()));
+}
+
+PollApp::~PollApp()
+{
+    for (int i = 0; i < m_devices.size(); ++i)
+        delete m_devices[i].snap;
+}
+
+bool PollApp::load(const QString& path, QString* err)
+{
+    QSettings ini(path, QSettings::IniFormat);
+    if (ini.status() != QSettings::NoError) {
+        if (err) *err = QString("%1 : read error").arg(path);
+        return false;
+    }
+    m_outPath = ini.value("output/file", m_outPath).toString();
+    m_outFormat = ini.value("output/format", m_outFormat).toString();
+
+    foreach (const QString& group, ini.childGroups()) {
+        if (group == "output") continue;
+        ini.beginGroup(group);
+        Device d;
+        d.name = group.toUtf8();
+        d.host = ini.value("host").toString();
+        d.port = quint16(ini.value("port", 502).toUInt());
+        d.uid = quint8(ini.value("unit", 1).toUInt());
+        d.intervalMs = ini.value("interval", 1000).toInt();
+        d.timeoutMs = ini.value("timeout", 1000).toInt();
+        d.multi = ini.value("multi", true).toBool();
+        d.swap = ini.value("swap", false).toBool();
+        const QString transport = ini.value("transport", "tcp").toString().toLower();
+        d.udp = transport == "udp";
+        d.retries = ini.value("retries", 2).toInt();
+        if (!d.udp && transport != "tcp") {
+            if (err) *err = QString("[%1] transport : tcp | udp").arg(group);
+            return false;
+        }
+        d.itemsDone = 0;
+        d.poller = 0;
+        d.snap = 0;
+        d.derivedSeq = 0;
+        // registers = name:addr, name:addr, ...
+        foreach (const QString& entry, ini.value("registers").toStringList()) {
+            const QStringList kv = entry.trimmed().split(':');
+            bool ok = false;
+            Register r;
+            r.addr = (kv.size() == 2) ? kv[1].trimmed().toUShort(&ok, 10) : 0;
+            if (!ok || r.addr == 0) {
+                if (err) *err = QString("[%1] bad register '%2'").arg(group).arg(entry);
+                return false;
+            }
+            r.name = kv[0].trimmed().toUtf8();
+            d.regs.append(r);
+        }
+        ini.endGroup();
+        for (int r = 0; r < d.regs.size(); ++r)
+            d.fieldOfReg.append(SnapshotPublisher::fieldIndex(d.regs[r].name));
+        if (d.host.isEmpty() || d.regs.isEmpty() || d.intervalMs <= 0 || d.timeoutMs <= 0) {
+            if (err) *err = QString("[%1] host / registers / interval / timeout required").arg(group);
+            return false;
+        }
+        m_devices.append(d);
+    }
+    if (m_devices.isEmpty()) {
+        if (err) *err = QString("%1 : no device").arg(path);
+        return false;
+    }
+    return true;
+}
+
+bool PollApp::openOutput(const QString& path, const QString& format, QString* err)
+{
+    SampleWriter::Format fmt;
+    if (!SampleWriter::parseFormat(format, fmt)) {
+        if (err) *err = QString("unknown format '%1' (csv | line | bin)").arg(format);
+        return false;
+    }
+    return m_writer.open(path, fmt, err);
+}
+
+void PollApp::start()
+{
+    for (int i = 0; i < m_devices.size(); ++i) {
+        Device& d = m_devices[i];
+        QVector<MbPollItem> items;
+        const int perReq = d.multi ? int(MAX_BLOCKS_PER_REQ) : 1;
+        for (int r = 0; r < d.regs.size(); r += perReq) {
+            MbPollItem it;
+            it.uid = d.uid;
+            it.regCount = 2;
+            for (int k = r; k < d.regs.size() && k < r + perReq; ++k)
+                it.starts.append(quint16(d.regs[k].addr - 1));
+            items.append(it);
+            d.itemFirstReg.append(r);
+        }
+        d.itemDone.fill(false, items.size());
+        d.snap = new SnapshotPublisher;
+        quint64 expected = 0;
+        foreach (int f, d.fieldOfReg)
+            if (f >= 0) expected |= quint64(1) << f;
+        d.snap->setExpected(expected);
+        d.poller = new MbPoller(this);
+        d.poller->setTimeout(d.timeoutMs);
+        if (d.udp) {
+            d.poller->setTransport(MbPoller::UDP);
+            d.poller->setRetries(d.retries);
+        }
+        d.poller->setItems(items);
+        m_deviceOf.insert(d.poller, i);
+        connect(d.poller, SIGNAL(replyReady(MbReply)), this, SLOT(onReply(MbReply)));
+        connect(d.poller, SIGNAL(requestTimedOut(int,quint16)), this, SLOT(onTimedOut(int,quint16)));
+        connect(d.poller, SIGNAL(connected()), this, SLOT(onConnected()));
+        connect(d.poller, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+        d.poller->start(d.host, d.port, d.intervalMs);
+    }
+    m_derivedTimer->start();
+}
+
+int PollApp::deviceIndex(QObject* s) const
+{
+    return m_deviceOf.value(qobject_cast<MbPoller*>(s), -1);
+}
+
+void PollApp::onReply(const MbReply& r)
+{
+    const int di = deviceIndex(sender());
+    if (di < 0 || r.item < 0) return;
+    Device& d = m_devices[di];
+    if (r.frame.isException()) {
+        qWarning("%s: exception fc=0x%02x code=%u", d.name.constData(), r.frame.function(), r.frame.exceptionCode());
+        itemFinished(d, r.item, DeviceSnapshot::Q_EXCEPTION, r.rxNs);
+        return;
+    }
+    const int first = d.itemFirstReg.value(r.item, -1);
+    if (first < 0) return;
+    m_writer.beginBatch(d.name, mb::monoToEpochMs(r.rxNs));
+    for (int i = 0; i < r.regs.floatCount() && first + i < d.regs.size(); ++i) {
+        const Register& reg = d.regs[first + i];
+        const float v = r.regs.floatAt(i, d.swap);
+        d.snap->set(d.fieldOfReg[first + i], v);
+        m_writer.add(reg.name, reg.addr, quint16(di), v);
+    }
+    m_writer.endBatch();
+    itemFinished(d, r.item, 0, r.rxNs);
+}
+
+// 모든 폴링 항목이 응답 또는 timeout 되면 그 주기의 snapshot 을 발행한다.
+// snapshot 시각은 주기를 끝낸 응답 (또는 timeout) 시각.
+void PollApp::itemFinished(Device& d, int item, quint32 quality, qint64 tNs)
+{
+    if (item < 0 || item >= d.itemDone.size() || d.itemDone[item]) return;
+    d.itemDone[item] = true;
+    d.snap->markQuality(quality);
+    if (++d.itemsDone < d.itemDone.size()) return;
+    if (!d.snap->publish(mb::monoToEpochMs(tNs)))
+        qWarning("%s: snapshot dropped (readers busy)", d.name.constData());
+    d.itemDone.fill(false);
+    d.itemsDone = 0;
+}
+
+void PollApp::onTimedOut(int item, quint16 tid)
+{
+    const int di = deviceIndex(sender());
+    if (di < 0) return;
+    qWarning("%s: timeout item=%d tid=%u", m_devices[di].name.constData(), item, tid);
+    itemFinished(m_devices[di], item, DeviceSnapshot::Q_TIMEOUT, mb::monoNs());
+}
+
+void PollApp::onConnected()
+{
+    const int di = deviceIndex(sender());
+    if (di < 0) return;
+    qWarning("%s: connected", m_devices[di].name.constData());
+}
+
+void PollApp::onDisconnected()
+{
+    const int di = deviceIndex(sender());
+    if (di < 0) return;
+    Device& d = m_devices[di];
+    qWarning("%s: disconnected", d.name.constData());
+    d.itemDone.fill(false);    // 진행 중 주기는 버린다
+    d.itemsDone = 0;
+}
+
+// 전압 phasor 가 모두 들어온 장치의 최신 snapshot 을 한 batch 로 묶어 파생 값을 계산한다.
+// 출력 이름은 *_calc, 주소는 0, 시각은 snapshot 주기 완료 시각.
+void PollApp::onDerivedTick()
+{
+    static const quint64 vMask = SnapshotPublisher::fieldMask(VPHASOR_NAMES, 6);
+    static const quint64 iMask = SnapshotPublisher::fieldMask(IPHASOR_NAMES, 6);
+    static const int lnField = SnapshotPublisher::fieldIndex("LN_ub");
+    static const int llField = SnapshotPublisher::fieldIndex("LL_ub");
+    static const int u0Field = SnapshotPublisher::fieldIndex("U0_ub");
+    static const int u2Field = SnapshotPublisher::fieldIndex("U2_ub");
+
+    m_batchDevice.clear();
+    m_batchTime.clear();
+    for (int i = 0; i < m_devices.size(); ++i) {
+        Device& d = m_devices[i];
+        if (!d.snap) continue;
+        SnapshotRef s(*d.snap);
+        if (!s.isNull() && s->seq != d.derivedSeq && s->hasAll(vMask)) m_batchDevice.append(i);
+    }
+    if (m_batchDevice.isEmpty()) return;
+
+    m_batch.resize(m_batchDevice.size());
+    for (int lane = 0; lane < m_batchDevice.size(); ++lane) {
+        Device& d = m_devices[m_batchDevice[lane]];
+        SnapshotRef s(*d.snap);      // 위에서 본 것보다 새 주기일 수 있다 (필드는 줄지 않음)
+        d.derivedSeq = s->seq;
+        unit::PT3Data pt = s->data;
+        // 음수 = 미터 값 없음
+        if (!s->has(lnField)) pt.vub.LN_ub = -1.0;
+        if (!s->has(llField)) pt.vub.LL_ub = -1.0;
+        if (!s->has(u0Field)) pt.vub.U0_ub = -1.0;
+        if (!s->has(u2Field)) pt.vub.U2_ub = -1.0;
+        float cur[6] = { 0, 0, 0, 0, 0, 0 };
+        if (s->hasAll(iMask)) {
+            cur[0] = float(s->iphasor.a_x); cur[1] = float(s->iphasor.a_y);
+            cur[2] = float(s->iphasor.b_x); cur[3] = float(s->iphasor.b_y);
+            cur[4] = float(s->iphasor.c_x); cur[5] = float(s->iphasor.c_y);
+        }
+        m_batch.load(lane, pt, cur);
+        m_batchTime.append(s->timeMs);
+    }
+    computeDerived(m_batch);
+
+    for (int lane = 0; lane < m_batchDevice.size(); ++lane) {
+        const int di = m_batchDevice[lane];
+        const DerivedBatch& b = m_batch;
+        const quint16 dev = quint16(di);
+        m_writer.beginBatch(m_devices[di].name, m_batchTime[lane]);
+        m_writer.add("Vab_calc", 0, dev, b.vAB[lane]);
+        m_writer.add("Vbc_calc", 0, dev, b.vBC[lane]);
+        m_writer.add("Vca_calc", 0, dev, b.vCA[lane]);
+        m_writer.add("angA_calc", 0, dev, b.angA[lane]);
+        m_writer.add("angB_calc", 0, dev, b.angB[lane]);
+        m_writer.add("angC_calc", 0, dev, b.angC[lane]);
+        m_writer.add("LN_ub_calc", 0, dev, b.lnUb[lane]);
+        m_writer.add("LL_ub_calc", 0, dev, b.llUb[lane]);
+        m_writer.add("U0_ub_calc", 0, dev, b.u0Ub[lane]);
+        m_writer.add("U2_ub_calc", 0, dev, b.u2Ub[lane]);
+        if (!(b.flags[lane] & DerivedBatch::FLAG_NO_CURRENT)) {
+            m_writer.add("pfA_calc", 0, dev, b.pfA[lane]);
+            m_writer.add("pfB_calc", 0, dev, b.pfB[lane]);
+            m_writer.add("pfC_calc", 0, dev, b.pfC[lane]);
+        }
+        // 미터 값이 있는 항목만
+        const quint8 f = b.flags[lane];
+        if (b.meterLN[lane] >= 0.0f) m_writer.add("LN_mismatch", 0, dev, (f & DerivedBatch::FLAG_LN_MISMATCH) ? 1.0f : 0.0f);
+        if (b.meterLL[lane] >= 0.0f) m_writer.add("LL_mismatch", 0, dev, (f & DerivedBatch::FLAG_LL_MISMATCH) ? 1.0f : 0.0f);
+        if (b.meterU0[lane] >= 0.0f) m_writer.add("U0_mismatch", 0, dev, (f & DerivedBatch::FLAG_U0_MISMATCH) ? 1.0f : 0.0f);
+        if (b.meterU2[lane] >= 0.0f) m_writer.add("U2_mismatch", 0, dev, (f & DerivedBatch::FLAG_U2_MISMATCH) ? 1.0f : 0.0f);
+        m_writer.endBatch();
+    }
+}
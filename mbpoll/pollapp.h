@@ -0,0 +1,80 @@
+#ifndef POLLAPP_H
+#define POLLAPP_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include "mbpoller.h"
+#include "derived.h"
+#include "snapshot.h"
+#include "samplewriter.h"
+
+class QTimer;
+
+// 설정 파일의 장치마다 MbPoller 하나를 두고 응답을 SampleWriter 로 내보낸다
+class PollApp : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PollApp(QObject *parent = 0);
+    ~PollApp();
+
+    bool load(const QString& path, QString* err);
+    bool openOutput(const QString& path, const QString& format, QString* err);
+    void start();
+
+    QString outputPath() const { return m_outPath; }
+    QString outputFormat() const { return m_outFormat; }
+
+private slots:
+    void onReply(const MbReply& r);
+    void onTimedOut(int item, quint16 tid);
+    void onConnected();
+    void onDisconnected();
+    void onDerivedTick();
+
+private:
+    enum { MAX_BLOCKS_PER_REQ = 31 };   // 0x65 응답이 MAX_ADU 안에 들어가는 블록 수
+    enum { DERIVED_MS = 1000 };
+
+    struct Register
+    {
+        QByteArray name;
+        quint16 addr;          // Accura 맵 주소 (1 기반)
+    };
+    struct Device
+    {
+        QByteArray name;
+        QString host;
+        quint16 port;
+        quint8 uid;
+        int intervalMs;
+        int timeoutMs;
+        bool multi;
+        bool swap;
+        bool udp;                    // transport=udp
+        int retries;                 // UDP 재전송 횟수
+        QVector<Register> regs;
+        QVector<int> itemFirstReg;   // 폴링 항목 -> 첫 레지스터 index
+        QVector<int> fieldOfReg;     // 레지스터 -> snapshot 필드, 없으면 -1
+        QVector<bool> itemDone;      // 이번 주기에 응답 / timeout 된 항목
+        int itemsDone;
+        MbPoller* poller;
+        SnapshotPublisher* snap;     // 주기마다 발행, 파생 값 계산이 읽는다
+        quint32 derivedSeq;          // 마지막으로 파생 값을 낸 snapshot
+    };
+    QVector<Device> m_devices;
+    QHash<MbPoller*, int> m_deviceOf;
+    SampleWriter m_writer;
+    DerivedBatch m_batch;
+    QVector<int> m_batchDevice;         // batch lane -> 장치 index
+    QVector<qint64> m_batchTime;        // batch lane -> snapshot 시각
+    QTimer* m_derivedTimer;
+    QString m_outPath;
+    QString m_outFormat;
+
+    int deviceIndex(QObject* s) const;
+    void itemFinished(Device& d, int item, quint32 quality, qint64 tNs);
+};
+
+#endif // POLLAPP_H
@@ -0,0 +1,105 @@
+#include "samplewriter.h"
+#include <cstdio>
+#include <cstring>
+
+SampleWriter::SampleWriter() :
+    m_fmt(Csv),
+    m_len(0),
+    m_fields(0),
+    m_timeMs(0)
+{
+}
+
+SampleWriter::~SampleWriter()
+{
+    flushBuf();
+}
+
+bool SampleWriter::parseFormat(const QString& name, Format& fmt)
+{
+    if (name == "csv") fmt = Csv;
+    else if (name == "line") fmt = Line;
+    else if (name == "bin" || name == "binary") fmt = Binary;
+    else return false;
+    return true;
+}
+
+bool SampleWriter::open(const QString& path, Format fmt, QString* err)
+{
+    m_fmt = fmt;
+    bool ok;
+    if (path.isEmpty() || path == "-")
+        ok = m_out.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered);
+    else {
+        m_out.setFileName(path);
+        ok = m_out.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered);
+    }
+    if (!ok) {
+        if (err) *err = m_out.errorString();
+        return false;
+    }
+    if (m_fmt == Csv && m_out.pos() == 0)
+        put("time_ms,device,register,address,value\n", 38);
+    return true;
+}
+
+void SampleWriter::put(const char* p, int n)
+{
+    if (m_len + n > BUF_SIZE) flushBuf();
+    if (n > BUF_SIZE) { m_out.write(p, n); return; }
+    memcpy(m_buf + m_len, p, n);
+    m_len += n;
+}
+
+void SampleWriter::flushBuf()
+{
+    if (m_len == 0 || !m_out.isOpen()) return;
+    m_out.write(m_buf, m_len);
+    m_len = 0;
+}
+
+void SampleWriter::beginBatch(const QByteArray& device, qint64 timeMs)
+{
+    m_device = device;
+    m_timeMs = timeMs;
+    m_fields = 0;
+}
+
+void SampleWriter::add(const QByteArray& name, quint16 addr, quint16 devIndex, float value)
+{
+    char line[256];
+    int n = 0;
+    switch (m_fmt) {
+    case Csv:
+        n = snprintf(line, sizeof(line), "%lld,%s,%s,%u,%.3f\n", (long long)m_timeMs,
+                     m_device.constData(), name.constData(), unsigned(addr), double(value));
+        break;
+    case Line:
+        if (m_fields == 0)
+            n = snprintf(line, sizeof(line), "accura,device=%s %s=%.3f", m_device.constData(), name.constData(), double(value));
+        else
+            n = snprintf(line, sizeof(line), ",%s=%.3f", name.constData(), double(value));
+        break;
+    case Binary: {
+        BinRecord r;
+        r.timeMs = m_timeMs;
+        r.device = devIndex;
+        r.addr = addr;
+        r.value = value;
+        put(reinterpret_cast<const char*>(&r), sizeof(r));
+        break;
+    }
+    }
+    if (n > 0) put(line, qMin(n, int(sizeof(line)) - 1));
+    ++m_fields;
+}
+
+void SampleWriter::endBatch()
+{
+    if (m_fmt == Line && m_fields > 0) {
+        char line[32];
+        const int n = snprintf(line, sizeof(line), " %lld000000\n", (long long)m_timeMs);
+        put(line, n);
+    }
+    flushBuf();
+}
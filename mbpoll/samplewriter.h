@@ -0,0 +1,42 @@
+#ifndef SAMPLEWRITER_H
+#define SAMPLEWRITER_H
+
+#include <QFile>
+#include <QString>
+
+// 디코드된 샘플 출력 (csv / InfluxDB line protocol / binary)
+// 레코드는 고정 버퍼에 모았다가 endBatch() 에서 한 번에 쓴다.
+class SampleWriter
+{
+public:
+    enum Format { Csv, Line, Binary };
+
+    SampleWriter();
+    ~SampleWriter();
+
+    static bool parseFormat(const QString& name, Format& fmt);
+
+    bool open(const QString& path, Format fmt, QString* err); // path "-" = stdout
+    void beginBatch(const QByteArray& device, qint64 timeMs);
+    void add(const QByteArray& name, quint16 addr, quint16 devIndex, float value);
+    void endBatch();
+
+private:
+    enum { BUF_SIZE = 16384 };
+    // binary 레코드 (little endian, 16 byte)
+    struct BinRecord { qint64 timeMs; quint16 device; quint16 addr; float value; };
+    static_assert(sizeof(BinRecord) == 16, "BinRecord layout");
+
+    QFile m_out;
+    Format m_fmt;
+    char m_buf[BUF_SIZE];
+    int m_len;
+    int m_fields;
+    qint64 m_timeMs;
+    QByteArray m_device;
+
+    void put(const char* p, int n);
+    void flushBuf();
+};
+
+#endif // SAMPLEWRITER_H
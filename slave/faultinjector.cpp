@@ -0,0 +1,258 @@
+#include "faultinjector.h"
+#include <QTcpSocket>
+#include <QTimer>
+#include <QSettings>
+#include <QStringList>
+#include <cstring>
+#include "mbclock.h"
+
+namespace {
+
+FaultInjector::Profile readProfile(QSettings& ini, const FaultInjector::Profile& base)
+{
+    FaultInjector::Profile p;
+    p.latencyMs = ini.value("latency_ms", base.latencyMs).toInt();
+    p.jitterMs = ini.value("jitter_ms", base.jitterMs).toInt();
+    p.drop = ini.value("drop", base.drop).toDouble();
+    p.split = ini.value("split", base.split).toDouble();
+    p.merge = ini.value("merge", base.merge).toDouble();
+    p.corruptMbap = ini.value("corrupt_mbap", base.corruptMbap).toDouble();
+    p.wrongTid = ini.value("wrong_tid", base.wrongTid).toDouble();
+    p.exception = ini.value("exception", base.exception).toDouble();
+    p.exceptionCode = ini.value("exception_code", base.exceptionCode).toInt();
+    p.disconnect = ini.value("disconnect", base.disconnect).toDouble();
+    return p;
+}
+
+}
+
+FaultInjector::FaultInjector(QObject *parent) :
+    QObject(parent),
+    m_enabled(false),
+    m_timer(new QTimer(this)),
+    m_rng(0x9E3779B97F4A7C15ULL)
+{
+    memset(&m_default, 0, sizeof(m_default));
+    m_default.exceptionCode = mb::EX_DEVICE_FAILURE;
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_timer->setInterval(TICK_MS);
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(onTick()));
+}
+
+bool FaultInjector::load(const QString& path, QString* err)
+{
+    QSettings ini(path, QSettings::IniFormat);
+    if (ini.status() != QSettings::NoError) {
+        if (err) *err = QString("%1 : read error").arg(path);
+        return false;
+    }
+    ini.beginGroup("default");
+    m_default = readProfile(ini, m_default);
+    const quint64 seed = ini.value("seed", 0).toULongLong();
+    ini.endGroup();
+    if (seed) m_rng = seed;
+
+    m_clientProfiles.clear();
+    m_ranges.clear();
+    foreach (const QString& group, ini.childGroups()) {
+        if (group == "default") continue;
+        ini.beginGroup(group);
+        const Profile p = readProfile(ini, m_default);
+        ini.endGroup();
+        if (group.startsWith("client.")) {
+            m_clientProfiles.insert(group.mid(7), p);
+        } else if (group.startsWith("range.")) {
+            // range.11100-11300
+            const QStringList ab = group.mid(6).split('-');
+            bool ok1 = false, ok2 = false;
+            Range r;
+            r.first = ab.size() == 2 ? ab[0].toUShort(&ok1) : 0;
+            r.last = ab.size() == 2 ? ab[1].toUShort(&ok2) : 0;
+            if (!ok1 || !ok2 || r.first > r.last) {
+                if (err) *err = QString("[%1] bad range").arg(group);
+                return false;
+            }
+            r.p = p;
+            m_ranges.append(r);
+        } else {
+            if (err) *err = QString("[%1] unknown section").arg(group);
+            return false;
+        }
+    }
+    m_enabled = true;
+    return true;
+}
+
+// xorshift64* : seed 가 같으면 같은 장애 순서
+// 모든 random 값은 여기서 뽑는다 (상태를 그냥 쓰면 앞 roll 이 건너뛰었을 때 같은 값이 반복됨)
+quint64 FaultInjector::nextRandom()
+{
+    m_rng ^= m_rng >> 12;
+    m_rng ^= m_rng << 25;
+    m_rng ^= m_rng >> 27;
+    return m_rng * 0x2545F4914F6CDD1DULL;
+}
+
+bool FaultInjector::roll(double rate)
+{
+    if (rate <= 0.0) return false;
+    return double(nextRandom() >> 11) * (1.0 / 9007199254740992.0) < rate;
+}
+
+// 요청 레지스터가 range 와 겹치면 range, 아니면 client, 아니면 default
+const FaultInjector::Profile& FaultInjector::profileFor(QTcpSocket* s, const mb::Frame& req) const
+{
+    if (!m_ranges.isEmpty()) {
+        quint16 starts[mb::MAX_READ_REGS];
+        quint16 counts[mb::MAX_READ_REGS];
+        int n = 0;
+        quint16 start = 0, count = 0;
+        mb::BlockView blocks;
+        if (mb::decodeReadRequest(req, start, count)) {
+            starts[0] = start;
+            counts[0] = count;
+            n = 1;
+        } else if (mb::decodeMultiReadRequest(req, blocks)) {
+            for (; n < blocks.count && n < int(mb::MAX_READ_REGS); ++n) {
+                starts[n] = blocks.start(n);
+                counts[n] = blocks.regs(n);
+            }
+        }
+        for (int i = 0; i < m_ranges.size(); ++i) {
+            const Range& r = m_ranges[i];
+            for (int k = 0; k < n; ++k) {
+                const int first = starts[k] + 1;              // 맵 주소
+                const int last = first + counts[k] - 1;
+                if (first <= r.last && last >= r.first) return r.p;
+            }
+        }
+    }
+    QString peer = s->peerAddress().toString();
+    if (peer.startsWith("::ffff:")) peer = peer.mid(7);     // dual stack 의 IPv4
+    QHash<QString, Profile>::const_iterator it = m_clientProfiles.constFind(peer);
+    return it != m_clientProfiles.constEnd() ? it.value() : m_default;
+}
+
+void FaultInjector::send(QTcpSocket* s, const mb::Frame& req, uchar* reply, int n)
+{
+    const Profile& p = profileFor(s, req);
+    Client& c = m_clients[s];
+    ++m_stats.replies;
+
+    if (roll(p.disconnect)) {
+        ++m_stats.disconnects;
+        c.kill = true;
+        m_timer->start();
+        return;
+    }
+    if (roll(p.drop)) {
+        ++m_stats.dropped;
+        return;
+    }
+    if (roll(p.exception)) {
+        ++m_stats.exceptions;
+        n = mb::encodeException(reply, mb::MAX_ADU, req.mb.tid, req.mb.uid, req.fc, quint8(p.exceptionCode));
+    }
+    if (roll(p.wrongTid)) {
+        ++m_stats.wrongTid;
+        mb::wr16be(reply, quint16(req.mb.tid + 0x1000));
+    }
+    if (roll(p.corruptMbap)) {
+        ++m_stats.corrupted;
+        if (nextRandom() >> 63) mb::wr16be(reply + 2, 0xFFFF);      // protocol id
+        else mb::wr16be(reply + 4, 0xFFFF);                // length
+    }
+
+    qint64 due = mb::monoMs();
+    if (p.latencyMs > 0 || p.jitterMs > 0) {
+        ++m_stats.delayed;
+        due += p.latencyMs;
+        if (p.jitterMs > 0) due += qint64(nextRandom() % quint64(p.jitterMs + 1));
+    }
+
+    QByteArray bytes;
+    if (!c.hold.isEmpty()) {
+        bytes = c.hold;                 // 보류한 응답과 한 번에
+        c.hold.clear();
+    }
+    bytes.append(reinterpret_cast<const char*>(reply), n);
+    if (roll(p.merge)) {
+        ++m_stats.merged;
+        c.hold = bytes;
+        c.holdMs = mb::monoMs();
+        m_timer->start();
+        return;
+    }
+    if (bytes.size() > 1 && roll(p.split)) {
+        ++m_stats.split;
+        const int cut = 1 + int(nextRandom() % quint64(bytes.size() - 1));
+        s->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        enqueue(s, c, due, bytes.left(cut));
+        enqueue(s, c, due + SPLIT_GAP_MS, bytes.mid(cut));
+        return;
+    }
+    enqueue(s, c, due, bytes);
+}
+
+// 순서는 유지한다 (jitter 로 앞 응답보다 먼저 나가지 않음)
+void FaultInjector::enqueue(QTcpSocket* s, Client& c, qint64 dueMs, const QByteArray& bytes)
+{
+    if (dueMs < c.lastDueMs) dueMs = c.lastDueMs;
+    c.lastDueMs = dueMs;
+    if (c.queue.isEmpty() && dueMs <= mb::monoMs()) {
+        s->write(bytes);
+        s->flush();
+        return;
+    }
+    Chunk ch;
+    ch.dueMs = dueMs;
+    ch.bytes = bytes;
+    c.queue.append(ch);
+    m_timer->start();
+}
+
+void FaultInjector::onTick()
+{
+    const qint64 now = mb::monoMs();
+    bool busy = false;
+    QList<QTcpSocket*> kill;
+    for (QHash<QTcpSocket*, Client>::iterator it = m_clients.begin(); it != m_clients.end(); ++it) {
+        QTcpSocket* s = it.key();
+        Client& c = it.value();
+        if (c.kill) {
+            kill << s;
+            continue;
+        }
+        if (!c.hold.isEmpty() && now - c.holdMs >= MERGE_HOLD_MS) {
+            enqueue(s, c, now, c.hold);     // 다음 요청이 안 오면 혼자 보낸다
+            c.hold.clear();
+        }
+        bool wrote = false;
+        while (!c.queue.isEmpty() && c.queue.first().dueMs <= now) {
+            s->write(c.queue.first().bytes);
+            c.queue.removeFirst();
+            wrote = true;
+        }
+        if (wrote) s->flush();
+        if (!c.queue.isEmpty() || !c.hold.isEmpty()) busy = true;
+    }
+    // abort 는 disconnected 를 바로 부르므로 순회가 끝난 뒤에
+    foreach (QTcpSocket* s, kill) {
+        m_clients.remove(s);
+        s->abort();
+    }
+    if (!busy) m_timer->stop();
+}
+
+void FaultInjector::removeClient(QTcpSocket* s)
+{
+    m_clients.remove(s);
+}
+
+QString FaultInjector::summary() const
+{
+    return QString("fault : replies %1 delay %2 drop %3 split %4 merge %5 corrupt %6 tid %7 exc %8 disc %9")
+            .arg(m_stats.replies).arg(m_stats.delayed).arg(m_stats.dropped).arg(m_stats.split)
+            .arg(m_stats.merged).arg(m_stats.corrupted).arg(m_stats.wrongTid).arg(m_stats.exceptions)
+            .arg(m_stats.disconnects);
+}
@@ -0,0 +1,102 @@
+#ifndef FAULTINJECTOR_H
+#define FAULTINJECTOR_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+#include <QHostAddress>
+#include "mbcodec.h"
+
+class QTcpSocket;
+class QTimer;
+
+// 응답 장애 주입 (master resync / timeout / 재연결 시험용)
+// 설정은 INI, 확률은 0~1. [default] 를 바탕으로 [client.<ip>] 와 [range.<first>-<last>] 가 덮어쓴다.
+class FaultInjector : public QObject
+{
+    Q_OBJECT
+public:
+    struct Profile
+    {
+        int latencyMs;          // 고정 지연
+        int jitterMs;           // 0 ~ jitter 추가 지연
+        double drop;            // 응답 버림
+        double split;           // 두 segment 로 나눠 보냄
+        double merge;           // 다음 응답과 한 segment 로 합침
+        double corruptMbap;     // protocol id / length 변조
+        double wrongTid;
+        double exception;       // 정상 요청에 예외 응답
+        int exceptionCode;
+        double disconnect;      // 응답 대신 연결 끊기
+    };
+
+    struct Stats
+    {
+        quint64 replies;
+        quint64 delayed;
+        quint64 dropped;
+        quint64 split;
+        quint64 merged;
+        quint64 corrupted;
+        quint64 wrongTid;
+        quint64 exceptions;
+        quint64 disconnects;
+    };
+
+    explicit FaultInjector(QObject *parent = 0);
+
+    bool load(const QString& path, QString* err);
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool on) { m_enabled = on; }
+
+    // reply 를 장애 규칙대로 보낸다 (바로, 지연, 버림 ...). reply 는 mb::MAX_ADU 버퍼
+    void send(QTcpSocket* s, const mb::Frame& req, uchar* reply, int n);
+    void removeClient(QTcpSocket* s);
+
+    const Stats& stats() const { return m_stats; }
+    QString summary() const;
+
+private slots:
+    void onTick();
+
+private:
+    enum { MERGE_HOLD_MS = 100, SPLIT_GAP_MS = 5, TICK_MS = 2 };
+
+    struct Range
+    {
+        quint16 first;          // Accura 맵 주소 (1 기반)
+        quint16 last;
+        Profile p;
+    };
+    struct Chunk
+    {
+        qint64 dueMs;
+        QByteArray bytes;
+    };
+    struct Client
+    {
+        QList<Chunk> queue;     // 보낼 순서대로
+        QByteArray hold;        // merge 대기
+        qint64 holdMs;
+        qint64 lastDueMs;
+        bool kill;              // 다음 tick 에 연결 끊기
+    };
+
+    bool m_enabled;
+    Profile m_default;
+    QHash<QString, Profile> m_clientProfiles;   // peer ip -> profile
+    QVector<Range> m_ranges;
+    QHash<QTcpSocket*, Client> m_clients;
+    QTimer* m_timer;
+    quint64 m_rng;
+    Stats m_stats;
+
+    const Profile& profileFor(QTcpSocket* s, const mb::Frame& req) const;
+    quint64 nextRandom();
+    bool roll(double rate);
+    void enqueue(QTcpSocket* s, Client& c, qint64 dueMs, const QByteArray& bytes);
+};
+
+#endif // FAULTINJECTOR_H
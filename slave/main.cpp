@@ -1,10 +1,40 @@
 #include "mainwindow.h"
 #include <QApplication>
+#include <QStringList>
+#include <QMessageBox>
+#include <QtDebug>
+#include "metricsserver.h"
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    const QStringList args = a.arguments();
+    // slave -m port : metrics endpoint (127.0.0.1, 0 = 끔)
+    quint16 metricsPort = 9103;
+    const int mi = args.indexOf("-m");
+    if (mi > 0 && mi + 1 < args.size()) metricsPort = args[mi + 1].toUShort();
+    MetricsServer metricsServer;
+    QString merr;
+    if (metricsPort && !metricsServer.listen(metricsPort, &merr))
+        qWarning("%s", qPrintable(merr));
+
     MainWindow w;
+    // slave -F faults.ini : 장애 주입 모드
+    const int fi = args.indexOf("-F");
+    if (fi > 0 && fi + 1 < args.size()) {
+        QString err;
+        if (!w.loadFaults(args[fi + 1], &err))
+            QMessageBox::warning(&w, "fault injection", err);
+    }
+    // slave -U units.ini : port / unit id 별 register bank
+    const int ui = args.indexOf("-U");
+    if (ui > 0 && ui + 1 < args.size()) {
+        QString err;
+        if (!w.loadUnits(args[ui + 1], &err))
+            QMessageBox::warning(&w, "units", err);
+    }
+    // slave -u : 같은 port 로 Modbus/UDP 도 받음
+    if (args.contains("-u")) w.enableUdp();
     w.show();
 
     return a.exec();
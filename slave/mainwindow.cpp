@@ -2,18 +2,33 @@
 #include "ui_mainwindow.h"
 #include <QMessageBox>
 #include <QAbstractSocket>
-#include <QtEndian>
-#include <QDataStream>
-#include <cstring>
+#include <QTimer>
+#include "mbclock.h"
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow),
-    m_server(new QTcpServer(this))
+    m_server(new QTcpServer(this)),
+    m_udp(false),
+    m_faults(new FaultInjector(this)),
+    m_faultTimer(new QTimer(this)),
+    m_unitTimer(new QTimer(this))
 {
     ui->setupUi(this);
     fillSlaveTable();
+    metrics::Registry& reg = metrics::Registry::global();
+    const QByteArray role("role=\"slave\"");
+    m_mRequests = reg.counter("mb_requests_total", "Modbus requests received", role);
+    m_mExceptions = reg.counter("mb_exceptions_total", "Exception replies built", role);
+    m_mResync = reg.counter("mb_resync_bytes_total", "Bytes skipped while resyncing the frame stream", role);
+    m_mBytesIn = reg.counter("mb_rx_bytes_total", "Bytes received", role);
+    m_mBytesOut = reg.counter("mb_tx_bytes_total", "Bytes sent", role);
+    m_mAccepted = reg.counter("mb_connects_total", "TCP connections accepted", role);
+    m_mClients = reg.gauge("mb_clients", "Connected clients", role);
+    m_mHandle = reg.histogram("mb_handle_seconds", "Request decode to reply build time", role);
     connect(m_server, SIGNAL(newConnection()), this, SLOT(onServerNewConnection()));
+    connect(m_faultTimer, SIGNAL(timeout()), this, SLOT(showFaultStats()));
+    connect(m_unitTimer, SIGNAL(timeout()), this, SLOT(onUnitTick()));
 }
 
 MainWindow::~MainWindow()
@@ -22,6 +37,34 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+bool MainWindow::loadFaults(const QString& path, QString* err)
+{
+    if (!m_faults->load(path, err)) return false;
+    setWindowTitle(windowTitle() + " [fault injection]");
+    m_faultTimer->start(1000);
+    return true;
+}
+
+void MainWindow::showFaultStats()
+{
+    ui->statusBar->showMessage(m_faults->summary());
+}
+
+bool MainWindow::loadUnits(const QString& path, QString* err)
+{
+    if (!m_units.load(path, err)) return false;
+    setWindowTitle(windowTitle() + QString(" [%1 units]").arg(m_units.unitCount()));
+    ui->statusBar->showMessage(m_units.summary());
+    m_unitTimer->start(UNIT_TICK_MS);
+    return true;
+}
+
+void MainWindow::onUnitTick()
+{
+    m_units.tick();
+    if (!m_faults->isEnabled()) ui->statusBar->showMessage(m_units.summary());
+}
+
 void MainWindow::on_addr_toggled(bool checked)
 {
     ui->ip->setReadOnly(checked);
@@ -52,7 +95,38 @@ bool MainWindow::startSlave(const QString& ip, quint16 port, QString& err)
     QHostAddress bindAddr;
     if (ip == "0.0.0.0" || ip.trimmed().isEmpty()) bindAddr = QHostAddress::Any;
     else if (!bindAddr.setAddress(ip)) { err = "binding IP error"; return false; }
+    if (m_units.hasPort(port)) { err = QString("port %1 is used by units.ini").arg(port); return false; }
     if (!m_server->listen(bindAddr, port)) { err = QString("listen fail : %1").arg(m_server->errorString()); return false; }
+    // units.ini 의 port 도 같은 IP 로
+    foreach (quint16 unitPort, m_units.ports()) {
+        QTcpServer* srv = new QTcpServer(this);
+        m_unitServers << srv;
+        if (!srv->listen(bindAddr, unitPort)) {
+            err = QString("listen fail (%1) : %2").arg(unitPort).arg(srv->errorString());
+            stopSlave();
+            return false;
+        }
+        connect(srv, SIGNAL(newConnection()), this, SLOT(onServerNewConnection()));
+    }
+    if (m_udp) {
+        if (!startUdp(bindAddr, port, err)) return false;
+        foreach (quint16 unitPort, m_units.ports())
+            if (!startUdp(bindAddr, unitPort, err)) return false;
+    }
+    return true;
+}
+
+bool MainWindow::startUdp(const QHostAddress& addr, quint16 port, QString& err)
+{
+    UdpEndpoint* ep = new UdpEndpoint(this);
+    m_udpEndpoints << ep;
+    QString e;
+    if (!ep->bind(addr, port, &e)) {
+        err = QString("udp listen fail (%1) : %2").arg(port).arg(e);
+        stopSlave();
+        return false;
+    }
+    connect(ep, SIGNAL(datagram(const uchar*,int,UdpPeer,qint64)), this, SLOT(onUdpDatagram(const uchar*,int,UdpPeer,qint64)));
     return true;
 }
 
@@ -63,9 +137,22 @@ void MainWindow::stopSlave()
         s->disconnect(this);
         s->disconnectFromHost();
         s->deleteLater();
-        m_srvBuf.remove(s);
+        delete m_srvBuf.take(s);
+        m_faults->removeClient(s);
+        m_clientMetrics.remove(s);
     }
     m_clients.clear();
+    m_mClients->set(0);
+    foreach (QTcpServer* srv, m_unitServers) {
+        srv->close();
+        srv->deleteLater();
+    }
+    m_unitServers.clear();
+    foreach (UdpEndpoint* ep, m_udpEndpoints) {
+        ep->close();
+        ep->deleteLater();
+    }
+    m_udpEndpoints.clear();
     if (m_server->isListening()) {
         m_server->close();
         isConnecting();
@@ -92,155 +179,151 @@ void MainWindow::on_stopListen_clicked()
 
 void MainWindow::onServerNewConnection()
 {
-    while (m_server->hasPendingConnections()) {
-        QTcpSocket* s = m_server->nextPendingConnection();
+    QTcpServer* srv = qobject_cast<QTcpServer*>(sender());
+    if (!srv) return;
+    while (srv->hasPendingConnections()) {
+        QTcpSocket* s = srv->nextPendingConnection();
         m_clients << s;
+        ClientMetrics cm;
+        cm.requests = metrics::Registry::global().counter("mb_client_requests_total", "Modbus requests per client ip",
+                                                          "role=\"slave\",client=\"" + s->peerAddress().toString().toLatin1() + '"');
+        cm.resyncSeen = 0;
+        m_clientMetrics.insert(s, cm);
+        m_mAccepted->add();
+        m_mClients->set(m_clients.size());
         connect(s, SIGNAL(readyRead()), this, SLOT(onClientReadyRead()));
         connect(s, SIGNAL(disconnected()), this, SLOT(onClientDisconnected()));
     }
 }
 
-bool MainWindow::takeOneModbusTcpFrame(QByteArray &buf, QByteArray &outFrame)
+quint16 MainWindow::tableReg(int row) const
 {
-    if (buf.size() < 7) return false;
-    const uchar* p = reinterpret_cast<const uchar*>(buf.constData());
-    const quint16 pid = qFromBigEndian<quint16>(p + 2);
-    const quint16 len = qFromBigEndian<quint16>(p + 4);
-    if (pid != 0x0000) { buf.remove(0, 1); return false; }
-    const int total = 6 + len;
-    if (total <= 6 || total > 260) { buf.remove(0, 1); return false; }
-    if (buf.size() < total) return false;
-    outFrame = buf.left(total);
-    buf.remove(0, total);
-    return true;
+    if (row < ui->parsetest_tableWidget->rowCount() && ui->parsetest_tableWidget->item(row,0)) {
+        bool ok=false;
+        quint16 v = ui->parsetest_tableWidget->item(row,0)->text().toUShort(&ok, 0);
+        if (ok) return v;
+    }
+    return 0;
 }
 
-bool MainWindow::parseModbusTcpFrame(const QByteArray& frame, Mbap& mb, quint8& fc, QByteArray& pdu)
+// bank 가 없으면 화면의 표
+void MainWindow::readRegs(const RegBank* bank, quint16 start, int count, quint16* out) const
 {
-    if (frame.size() < 8) return false;
-    const uchar* p = reinterpret_cast<const uchar*>(frame.constData());
-    mb.tid = qFromBigEndian<quint16>(p + 0);
-    mb.pid = qFromBigEndian<quint16>(p + 2);
-    mb.len = qFromBigEndian<quint16>(p + 4);
-    mb.uid = *(p + 6);
-
-    if (mb.pid != 0x0000) return false;
-    if (mb.len < 2) return false;
-
-    fc  = *(p + 7); // funccode
-    if(fc == 0x03) // 03
-        pdu = frame.mid(8);
-    else if(fc == 0x65) // 101
-    {
-        pdu = frame.mid(8, 1);
-        switch(frame.size())
-        {
-        case 25:
-            pdu.append(frame.mid(17));
-            break;
-        case 33:
-            pdu.append(frame.mid(21));
-            break;
-        case 41:
-            pdu.append(frame.mid(25));
-            break;
-        case 49:
-            pdu.append(frame.mid(29));
-            break;
-        }
+    if (bank) {
+        bank->read(start, count, out);
+        return;
     }
-    applyCnt++;
-    return true;
+    for (int i = 0; i < count; ++i)
+        out[i] = tableReg(start + i);
 }
 
-QByteArray MainWindow::buildModbus03Reply(quint16 transId, quint8 unitId, const QVector<quint16>& regs)
+int MainWindow::buildReply(const mb::Frame& f, const RegBank* bank, uchar* out, int cap) const
 {
-    const quint8 fc = 0x03;
-    const quint8 byteCount = quint8(regs.size() * 2);
-    QByteArray frame;
-    QDataStream out(&frame, QIODevice::WriteOnly);
-    out.setByteOrder(QDataStream::BigEndian);
-    quint16 len = 1 + 1 + 1 + byteCount;
-    out << transId;
-    out << quint16(0x0000);
-    out << len;
-    out << unitId;
-    out << fc;
-    out << byteCount;
-    for (quint16 v : regs) out << v;
-    return frame;
+    quint16 regs[mb::MAX_READ_REGS];
+    if (f.fc == mb::FC_READ_HOLDING)
+    {
+        quint16 startAddr = 0, regCount = 0;
+        if (!mb::decodeReadRequest(f, startAddr, regCount) || regCount == 0 || regCount > mb::MAX_READ_REGS)
+            return mb::encodeException(out, cap, f.mb.tid, f.mb.uid, f.fc, mb::EX_ILLEGAL_VALUE);
+        readRegs(bank, startAddr, regCount, regs);
+        return mb::encodeReadReply(out, cap, f.mb.tid, f.mb.uid, regs, regCount);
+    }
+    if (f.fc == mb::FC_MULTI_READ)
+    {
+        mb::BlockView blocks;
+        if (!mb::decodeMultiReadRequest(f, blocks))
+            return mb::encodeException(out, cap, f.mb.tid, f.mb.uid, f.fc, mb::EX_ILLEGAL_VALUE);
+        int nRegs = 0;
+        for (int b = 0; b < blocks.count; ++b) {
+            const quint16 startAddr = blocks.start(b);
+            const quint16 regCount = blocks.regs(b);
+            if (nRegs + regCount > mb::MAX_READ_REGS)
+                return mb::encodeException(out, cap, f.mb.tid, f.mb.uid, f.fc, mb::EX_ILLEGAL_VALUE);
+            readRegs(bank, startAddr, regCount, regs + nRegs);
+            nRegs += regCount;
+        }
+        const int n = mb::encodeMultiReadReply(out, cap, f.mb.tid, f.mb.uid, blocks, regs, nRegs);
+        if (n == 0)
+            return mb::encodeException(out, cap, f.mb.tid, f.mb.uid, f.fc, mb::EX_ILLEGAL_VALUE);
+        return n;
+    }
+    return mb::encodeException(out, cap, f.mb.tid, f.mb.uid, f.fc, mb::EX_ILLEGAL_FUNCTION);
 }
 
-QByteArray MainWindow::buildModbus65Reply(quint16 transId, quint8 unitId, const QVector<quint16>& regs)
+// TCP / UDP 공용 : 응답을 만들고 지표를 센다. 보낼 것이 없으면 0
+int MainWindow::handleRequest(const mb::Frame& f, quint16 port, uchar* out, int cap)
 {
-    const quint8 fc = 0x65;
-    const quint8 byteCount = quint8(regs.size() * 2);
-    QByteArray frame;
-    QDataStream out(&frame, QIODevice::WriteOnly);
-    out.setByteOrder(QDataStream::BigEndian);
-    quint16 len = 1 + 1 + 1 + byteCount;
-    out << transId;
-    out << quint16(0x0000);
-    out << len;
-    out << unitId;
-    out << fc;
-    out << byteCount;
-    for (quint16 v : regs) out << v;
-    return frame;
+    const qint64 t0 = mb::monoNs();
+    m_mRequests->add();
+    int n;
+    if (m_units.hasPort(port)) {
+        // 없는 unit 은 gateway 처럼 예외
+        UnitMap::Unit* u = m_units.unit(port, f.mb.uid);
+        if (u) {
+            ++u->requests;
+            n = buildReply(f, &u->bank, out, cap);
+        } else {
+            n = mb::encodeException(out, cap, f.mb.tid, f.mb.uid, f.fc, mb::EX_GATEWAY_TARGET);
+        }
+    } else {
+        n = buildReply(f, 0, out, cap);
+    }
+    if (n <= 0) return 0;
+    m_mHandle->observeUs((mb::monoNs() - t0) / 1000);
+    if (out[7] & mb::FC_EXCEPTION) m_mExceptions->add();
+    m_mBytesOut->add(n);
+    return n;
 }
 
 void MainWindow::onClientReadyRead()
 {
     QTcpSocket* s = qobject_cast<QTcpSocket*>(sender());
     if (!s) return;
-    m_srvBuf[s].append(s->readAll());
-    QByteArray frame;
-    while (takeOneModbusTcpFrame(m_srvBuf[s], frame)) {
-        Mbap mb; quint8 fc=0; QByteArray pdu;
-        if (!parseModbusTcpFrame(frame, mb, fc, pdu)) continue;
-        if (fc == 0x03)
-        {
-            if (pdu.size() < 4) continue;
-            const uchar* pp = reinterpret_cast<const uchar*>(pdu.constData());
-            quint16 startAddr = qFromBigEndian<quint16>(pp + 0);
-            quint16 regCount  = qFromBigEndian<quint16>(pp + 2);
-            QVector<quint16> regs; regs.reserve(regCount);
-            for (int i = 0; i < regCount; ++i) {
-                int row = startAddr + i;
-                quint16 v = 0;
-                if (row < ui->parsetest_tableWidget->rowCount() && ui->parsetest_tableWidget->item(row,0)) {
-                    bool ok=false;
-                    v = ui->parsetest_tableWidget->item(row,0)->text().toUShort(&ok, 0);
-                    if (!ok) v = 0;
-                }
-                regs.push_back(v);
-            }
-            QByteArray resp = buildModbus03Reply(mb.tid, mb.uid, regs);
-            s->write(resp);
-            s->flush();
-        }
-        if (fc == 0x65)
-        {
-            if (pdu.size() < 4) continue;
-            const uchar* pp = reinterpret_cast<const uchar*>(pdu.constData());
-            quint16 startAddr = qFromBigEndian<quint16>(pp + 0);
-            quint16 regCount  = qFromBigEndian<quint16>(pp + 2);
-            QVector<quint16> regs; regs.reserve(regCount);
-            for (int i = 0; i < regCount; ++i) {
-                int row = startAddr + i;
-                quint16 v = 0;
-                if (row < ui->parsetest_tableWidget->rowCount() && ui->parsetest_tableWidget->item(row,0)) {
-                    bool ok=false;
-                    v = ui->parsetest_tableWidget->item(row,0)->text().toUShort(&ok, 0);
-                    if (!ok) v = 0;
-                }
-                regs.push_back(v);
-            }
-            QByteArray resp = buildModbus03Reply(mb.tid, mb.uid, regs);
-            s->write(resp);
-            s->flush();
+    mb::FrameReader*& reader = m_srvBuf[s];
+    if (!reader) reader = new mb::FrameReader;
+    const QByteArray data = s->readAll();
+    m_mBytesIn->add(data.size());
+    reader->append(data);
+    ClientMetrics& cm = m_clientMetrics[s];
+    const quint16 port = s->localPort();
+    mb::Frame f;
+    uchar resp[mb::MAX_ADU];
+    bool wrote = false;
+    while (reader->next(f)) {
+        if (f.isException()) continue;
+        if (cm.requests) cm.requests->add();
+        const int n = handleRequest(f, port, resp, sizeof(resp));
+        if (n <= 0) continue;
+        if (m_faults->isEnabled()) {
+            m_faults->send(s, f, resp, n);
+            continue;
         }
+        s->write(reinterpret_cast<const char*>(resp), n);
+        wrote = true;
+    }
+    if (wrote) s->flush();
+    if (reader->resyncBytes() != cm.resyncSeen) {
+        m_mResync->add(reader->resyncBytes() - cm.resyncSeen);
+        cm.resyncSeen = reader->resyncBytes();
+    }
+}
+
+// datagram 하나 = 요청 하나. 응답은 batch 가 끝날 때 한꺼번에 나간다 (장애 주입은 TCP 만)
+void MainWindow::onUdpDatagram(const uchar* p, int n, const UdpPeer& from, qint64 rxNs)
+{
+    Q_UNUSED(rxNs);
+    UdpEndpoint* ep = qobject_cast<UdpEndpoint*>(sender());
+    if (!ep) return;
+    m_mBytesIn->add(n);
+    mb::Frame f;
+    if (mb::frameLength(p, n) != n || !mb::parseFrame(p, n, f)) {
+        m_mResync->add(n);
+        return;
     }
+    if (f.isException()) return;
+    uchar resp[mb::MAX_ADU];
+    const int len = handleRequest(f, ep->localPort(), resp, sizeof(resp));
+    if (len > 0) ep->queue(resp, len, &from);
 }
 
 void MainWindow::onClientDisconnected()
@@ -248,7 +331,10 @@ void MainWindow::onClientDisconnected()
     QTcpSocket* s = qobject_cast<QTcpSocket*>(sender());
     if (!s) return;
     m_clients.removeAll(s);
-    m_srvBuf.remove(s);
+    delete m_srvBuf.take(s);
+    m_faults->removeClient(s);
+    m_clientMetrics.remove(s);
+    m_mClients->set(m_clients.size());
     s->deleteLater();
 }
 
@@ -7,10 +7,15 @@
 #include <QHostAddress>
 #include <QVector>
 #include <QHash>
+#include "mbcodec.h"
+#include "faultinjector.h"
+#include "unitmap.h"
+#include "udpendpoint.h"
+#include "metrics.h"
 
-namespace Ui { class MainWindow; }
+class QTimer;
 
-struct Mbap { quint16 tid; quint16 pid; quint16 len; quint8 uid; };
+namespace Ui { class MainWindow; }
 
 class MainWindow : public QMainWindow
 {
@@ -19,6 +24,11 @@ public:
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
 
+    bool loadFaults(const QString& path, QString* err);
+    bool loadUnits(const QString& path, QString* err);
+    // Listen 때 같은 port 로 Modbus/UDP 도 받음
+    void enableUdp() { m_udp = true; }
+
 private slots:
     void on_addr_toggled(bool checked);
     void on_listen_clicked();
@@ -26,21 +36,50 @@ private slots:
     void onServerNewConnection();
     void onClientReadyRead();
     void onClientDisconnected();
+    void onUdpDatagram(const uchar* p, int n, const UdpPeer& from, qint64 rxNs);
+    void showFaultStats();
+    void onUnitTick();
 
 private:
+    enum { UNIT_TICK_MS = 1000 };
+
     Ui::MainWindow *ui;
     QTcpServer* m_server;
+    QList<QTcpServer*> m_unitServers;     // units.ini 의 port
+    bool m_udp;
+    QList<UdpEndpoint*> m_udpEndpoints;   // 화면 port + units.ini port
     QList<QTcpSocket*> m_clients;
-    QHash<QTcpSocket*, QByteArray> m_srvBuf;
+    QHash<QTcpSocket*, mb::FrameReader*> m_srvBuf;
+    // metrics (role="slave")
+    struct ClientMetrics
+    {
+        metrics::Counter* requests;     // client ip 별
+        quint64 resyncSeen;
+    };
+    QHash<QTcpSocket*, ClientMetrics> m_clientMetrics;
+    metrics::Counter* m_mRequests;
+    metrics::Counter* m_mExceptions;
+    metrics::Counter* m_mResync;
+    metrics::Counter* m_mBytesIn;
+    metrics::Counter* m_mBytesOut;
+    metrics::Counter* m_mAccepted;
+    metrics::Gauge* m_mClients;
+    metrics::Histogram* m_mHandle;
+    FaultInjector* m_faults;
+    QTimer* m_faultTimer;
+    UnitMap m_units;                      // 비어 있으면 모든 uid 가 표 하나를 씀
+    QTimer* m_unitTimer;
 
     bool parseInputs(QString &ip, quint16 &port, int &timeoutMs, QString &err);
     bool startSlave(const QString& ip, quint16 port, QString& err);
     void stopSlave();
     void isConnecting();
 
-    static bool takeOneModbusTcpFrame(QByteArray& buf, QByteArray& outFrame);
-    static bool parseModbusTcpFrame(const QByteArray& frame, Mbap& mb, quint8& fc, QByteArray& pdu);
-    static QByteArray buildModbus03Reply(quint16 transId, quint8 unitId, const QVector<quint16>& regs);
+    quint16 tableReg(int row) const;
+    void readRegs(const RegBank* bank, quint16 start, int count, quint16* out) const;
+    int buildReply(const mb::Frame& f, const RegBank* bank, uchar* out, int cap) const;
+    int handleRequest(const mb::Frame& f, quint16 port, uchar* out, int cap);
+    bool startUdp(const QHostAddress& addr, quint16 port, QString& err);
     void fillSlaveTable();
 };
 
@@ -12,13 +12,19 @@ QMAKE_CXXFLAGS += -std=gnu++11
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+include(../mbcore/mbcore.pri)
+
 TARGET = slave
 TEMPLATE = app
 
 
 SOURCES += main.cpp\
-        mainwindow.cpp
+        mainwindow.cpp\
+        faultinjector.cpp\
+        unitmap.cpp
 
-HEADERS  += mainwindow.h
+HEADERS  += mainwindow.h\
+        faultinjector.h\
+        unitmap.h
 
 FORMS    += mainwindow.ui
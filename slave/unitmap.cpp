@@ -0,0 +1,261 @@
+#include "unitmap.h"
+#include <QSettings>
+#include <QStringList>
+#include <cstring>
+
+// ---------------------------------------------------------------- RegBank
+
+quint16 RegBank::reg(quint16 addr) const
+{
+    const Page* p = m_pages[addr >> PAGE_BITS].constData();
+    return p ? p->r[addr & (PAGE_SIZE - 1)] : 0;
+}
+
+void RegBank::read(quint16 start, int count, quint16* out) const
+{
+    int addr = start;
+    while (count > 0 && addr < 65536) {
+        const int off = addr & (PAGE_SIZE - 1);
+        const int n = qMin(count, PAGE_SIZE - off);
+        const Page* p = m_pages[addr >> PAGE_BITS].constData();
+        if (p) memcpy(out, p->r + off, n * sizeof(quint16));
+        else memset(out, 0, n * sizeof(quint16));
+        out += n;
+        addr += n;
+        count -= n;
+    }
+    if (count > 0) memset(out, 0, count * sizeof(quint16));
+}
+
+void RegBank::setReg(quint16 addr, quint16 v)
+{
+    QSharedDataPointer<Page>& p = m_pages[addr >> PAGE_BITS];
+    if (!p) {
+        if (v == 0) return;
+        p = new Page;
+        memset(p->r, 0, sizeof(p->r));
+    }
+    // 공유 중이면 여기서 page 복사
+    if (p.constData()->r[addr & (PAGE_SIZE - 1)] != v)
+        p->r[addr & (PAGE_SIZE - 1)] = v;
+}
+
+void RegBank::setFloat(quint16 addr, float v)
+{
+    quint32 u;
+    memcpy(&u, &v, sizeof(u));
+    setReg(addr, quint16(u >> 16));
+    setReg(quint16(addr + 1), quint16(u));
+}
+
+int RegBank::privatePages() const
+{
+    int n = 0;
+    for (int i = 0; i < PAGES; ++i) {
+        const Page* p = m_pages[i].constData();
+#if QT_VERSION >= 0x050000
+        if (p && p->ref.load() == 1) ++n;
+#else
+        if (p && int(p->ref) == 1) ++n;
+#endif
+    }
+    return n;
+}
+
+// ---------------------------------------------------------------- UnitMap
+
+namespace {
+
+// "1-50,60,70-72" (QSettings 가 ',' 로 나눠서 줌)
+bool parseUids(const QStringList& parts, QList<int>& out)
+{
+    foreach (const QString& part, parts) {
+        const QStringList ab = part.trimmed().split('-');
+        bool ok1 = false, ok2 = true;
+        const int a = ab[0].toInt(&ok1);
+        const int b = ab.size() == 2 ? ab[1].toInt(&ok2) : a;
+        if (!ok1 || !ok2 || ab.size() > 2 || a < 0 || b > 255 || a > b) return false;
+        for (int u = a; u <= b; ++u) out.append(u);
+    }
+    return !out.isEmpty();
+}
+
+quint64 nextRng(quint64& s)
+{
+    s ^= s >> 12;
+    s ^= s << 25;
+    s ^= s >> 27;
+    return s * 0x2545F4914F6CDD1DULL;
+}
+
+}
+
+UnitMap::UnitMap()
+{
+}
+
+UnitMap::~UnitMap()
+{
+    clear();
+}
+
+void UnitMap::clear()
+{
+    qDeleteAll(m_ports);
+    m_ports.clear();
+    qDeleteAll(m_units);
+    m_units.clear();
+}
+
+// 다른 UnitMap 에 읽고 성공하면 바꾼다 (실패하면 지금 설정 유지, 반쯤 만든 것은 next 소멸자가 지움)
+bool UnitMap::load(const QString& path, QString* err)
+{
+    UnitMap next;
+    if (!next.parse(path, err)) return false;
+    clear();
+    m_ports.swap(next.m_ports);
+    m_units.swap(next.m_units);
+    return true;
+}
+
+bool UnitMap::parse(const QString& path, QString* err)
+{
+    QSettings ini(path, QSettings::IniFormat);
+    if (ini.status() != QSettings::NoError) {
+        if (err) *err = QString("%1 : read error").arg(path);
+        return false;
+    }
+
+    QHash<QString, Template> templates;
+    foreach (const QString& group, ini.childGroups()) {
+        if (!group.startsWith("template.")) continue;
+        Template& t = templates[group.mid(9)];
+        ini.beginGroup(group);
+        foreach (const QString& key, ini.childKeys()) {
+            // reg.<addr>=값, float.<addr>=값, walk.<addr>=step
+            const int dot = key.indexOf('.');
+            bool okAddr = false;
+            const uint addr = key.mid(dot + 1).toUInt(&okAddr, 0);
+            const QString kind = key.left(dot);
+            bool okVal = false;
+            if (dot < 0 || !okAddr || addr > 65535) {
+                okVal = false;
+            } else if (kind == "reg") {
+                const uint v = ini.value(key).toString().toUInt(&okVal, 0);
+                okVal = okVal && v <= 0xFFFF;
+                if (okVal) t.bank.setReg(quint16(addr), quint16(v));
+            } else if (kind == "float") {
+                const float v = ini.value(key).toString().toFloat(&okVal);
+                if (okVal) t.bank.setFloat(quint16(addr), v);
+            } else if (kind == "walk") {
+                const float step = ini.value(key).toString().toFloat(&okVal);
+                if (okVal) {
+                    t.walkAddr.append(quint16(addr));
+                    t.walkStep.append(step);
+                }
+            }
+            if (!okVal) {
+                if (err) *err = QString("[%1] %2 : bad entry").arg(group, key);
+                ini.endGroup();
+                return false;
+            }
+        }
+        ini.endGroup();
+        // walk 기준값은 template 의 float 값
+        for (int i = 0; i < t.walkAddr.size(); ++i) {
+            const quint32 u = (quint32(t.bank.reg(t.walkAddr[i])) << 16) | t.bank.reg(quint16(t.walkAddr[i] + 1));
+            float v;
+            memcpy(&v, &u, sizeof(v));
+            t.walkBase.append(v);
+        }
+    }
+
+    foreach (const QString& group, ini.childGroups()) {
+        if (group.startsWith("template.")) continue;
+        if (!group.startsWith("port.")) {
+            if (err) *err = QString("[%1] unknown section").arg(group);
+            return false;
+        }
+        bool okPort = false;
+        const uint port = group.mid(5).toUInt(&okPort);
+        ini.beginGroup(group);
+        const QString tname = ini.value("template").toString();
+        QList<int> uids;
+        const bool okUids = parseUids(ini.value("units").toStringList(), uids);
+        ini.endGroup();
+        if (!okPort || port == 0 || port > 65535) {
+            if (err) *err = QString("[%1] bad port").arg(group);
+            return false;
+        }
+        if (!okUids) {
+            if (err) *err = QString("[%1] bad units").arg(group);
+            return false;
+        }
+        if (!templates.contains(tname)) {
+            if (err) *err = QString("[%1] unknown template '%2'").arg(group, tname);
+            return false;
+        }
+        const Template& t = templates[tname];
+        Port* p = m_ports.value(quint16(port));
+        if (!p) {
+            p = new Port;
+            memset(p->units, 0, sizeof(p->units));
+            m_ports.insert(quint16(port), p);
+        }
+        foreach (int uid, uids) {
+            if (p->units[uid]) {
+                if (err) *err = QString("[%1] unit %2 twice").arg(group).arg(uid);
+                return false;
+            }
+            Unit* u = new Unit;
+            u->uid = quint8(uid);
+            u->bank = t.bank;                   // page 공유
+            u->walkAddr = t.walkAddr;
+            u->walkStep = t.walkStep;
+            u->walkBase = t.walkBase;
+            u->walkValue = t.walkBase;
+            u->rng = 0x9E3779B97F4A7C15ULL ^ (quint64(port) << 8 | quint64(uid));
+            u->requests = 0;
+            p->units[uid] = u;
+            m_units.append(u);
+        }
+    }
+    if (m_units.isEmpty()) {
+        if (err) *err = QString("%1 : no [port.*] units").arg(path);
+        return false;
+    }
+    return true;
+}
+
+UnitMap::Unit* UnitMap::unit(quint16 port, quint8 uid) const
+{
+    const Port* p = m_ports.value(port);
+    return p ? p->units[uid] : 0;
+}
+
+// 기준값 쪽으로 조금 당기면서 +-step 만큼 움직인다
+void UnitMap::tick()
+{
+    foreach (Unit* u, m_units) {
+        for (int i = 0; i < u->walkAddr.size(); ++i) {
+            const double r = double(nextRng(u->rng) >> 11) * (1.0 / 9007199254740992.0);
+            float& v = u->walkValue[i];
+            v = u->walkBase[i] + (v - u->walkBase[i]) * 0.9f + u->walkStep[i] * float(2.0 * r - 1.0);
+            u->bank.setFloat(u->walkAddr[i], v);
+        }
+    }
+}
+
+QString UnitMap::summary() const
+{
+    int priv = 0;
+    quint64 req = 0;
+    foreach (const Unit* u, m_units) {
+        priv += u->bank.privatePages();
+        req += u->requests;
+    }
+    return QString("units %1 on %2 port(s) | private pages %3 (%4 KB) | requests %5")
+            .arg(m_units.size()).arg(m_ports.size())
+            .arg(priv).arg(priv * int(sizeof(quint16)) * RegBank::PAGE_SIZE / 1024)
+            .arg(req);
+}
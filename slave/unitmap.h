@@ -0,0 +1,90 @@
+#ifndef UNITMAP_H
+#define UNITMAP_H
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QSharedData>
+#include <QtCore/QSharedDataPointer>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+// unit id 별 register bank (주소 0 ~ 65535)
+// 256 레지스터 page 를 공유하고, 쓸 때 그 page 만 복사한다 (copy-on-write).
+// 같은 template 에서 만든 unit 은 값을 바꾼 page 만 따로 갖는다.
+class RegBank
+{
+public:
+    enum { PAGE_BITS = 8, PAGE_SIZE = 1 << PAGE_BITS, PAGES = 65536 / PAGE_SIZE };
+
+    quint16 reg(quint16 addr) const;
+    void read(quint16 start, int count, quint16* out) const;
+    void setReg(quint16 addr, quint16 v);
+    void setFloat(quint16 addr, float v);       // hi, lo 순서 2 레지스터
+
+    // 다른 bank 와 공유하지 않는 page 수
+    int privatePages() const;
+
+private:
+    struct Page : public QSharedData
+    {
+        quint16 r[PAGE_SIZE];
+    };
+    QSharedDataPointer<Page> m_pages[PAGES];    // null = 모두 0
+};
+
+// 여러 port 에 unit 여럿을 올리는 설정 (slave -U units.ini)
+class UnitMap
+{
+public:
+    struct Unit
+    {
+        quint8 uid;
+        RegBank bank;
+        // 시뮬레이터 : float 레지스터 random walk
+        QVector<quint16> walkAddr;
+        QVector<float> walkStep;
+        QVector<float> walkBase;
+        QVector<float> walkValue;
+        quint64 rng;
+        quint64 requests;
+    };
+
+    UnitMap();
+    ~UnitMap();
+
+    bool load(const QString& path, QString* err);
+    void clear();
+
+    QList<quint16> ports() const { return m_ports.keys(); }
+    bool hasPort(quint16 port) const { return m_ports.contains(port); }
+    // 없으면 0
+    Unit* unit(quint16 port, quint8 uid) const;
+    int unitCount() const { return m_units.size(); }
+
+    // 시뮬레이터 한 단계 (unit 마다 독립)
+    void tick();
+    QString summary() const;
+
+private:
+    struct Template
+    {
+        RegBank bank;
+        QVector<quint16> walkAddr;
+        QVector<float> walkStep;
+        QVector<float> walkBase;
+    };
+    struct Port
+    {
+        Unit* units[256];
+    };
+
+    QHash<quint16, Port*> m_ports;
+    QList<Unit*> m_units;
+
+    bool parse(const QString& path, QString* err);
+
+    Q_DISABLE_COPY(UnitMap)
+};
+
+#endif // UNITMAP_H